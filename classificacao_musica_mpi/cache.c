@@ -0,0 +1,178 @@
+#include "cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MEMO_INITIAL_SLOTS 1024
+
+static const char *label_names[] = { "neutro", "positivo", "negativo", "neutro", "neutro" };
+
+uint64_t cache_key(const char *identity, const char *text, size_t len) {
+    // FNV-1a de 64 bits sobre identidade + '\0' + letra
+    uint64_t h = 14695981039346656037ULL;
+    for (const char *p = identity; ; p++) {
+        h ^= (unsigned char)*p;
+        h *= 1099511628211ULL;
+        if (*p == '\0') break;
+    }
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)text[i];
+        h *= 1099511628211ULL;
+    }
+    return h ? h : 1;   // 0 marca posição vazia na CacheMemo
+}
+
+uint8_t cache_label_code(const char *label) {
+    for (uint8_t code = CACHE_POSITIVE; code <= CACHE_NEUTRAL; code++) {
+        if (strcmp(label, label_names[code]) == 0) return code;
+    }
+    return CACHE_FAILED;
+}
+
+const char *cache_label_name(uint8_t code) {
+    return code <= CACHE_FAILED ? label_names[code] : "neutro";
+}
+
+int cache_open(ResultCache *cache, const char *path) {
+    memset(cache, 0, sizeof(*cache));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    const CacheHeader *h = base;
+    size_t size = (size_t)st.st_size;
+    if (memcmp(h->magic, CACHE_MAGIC, 8) != 0 || h->version != CACHE_VERSION ||
+        h->header_size != sizeof(CacheHeader) ||
+        h->count != (size - sizeof(CacheHeader)) / sizeof(CacheEntry) ||
+        (size - sizeof(CacheHeader)) % sizeof(CacheEntry) != 0) {
+        munmap(base, size);
+        return -1;
+    }
+    cache->base = base;
+    cache->size = size;
+    cache->entries = (const CacheEntry *)((const char *)base + sizeof(CacheHeader));
+    cache->count = h->count;
+    return 0;
+}
+
+int cache_lookup(const ResultCache *cache, uint64_t key, uint8_t *label) {
+    uint64_t lo = 0, hi = cache->count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (cache->entries[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < cache->count && cache->entries[lo].key == key) {
+        *label = cache->entries[lo].label;
+        return 1;
+    }
+    return 0;
+}
+
+void cache_close(ResultCache *cache) {
+    if (cache->base != NULL) munmap(cache->base, cache->size);
+    memset(cache, 0, sizeof(*cache));
+}
+
+static int compare_entries(const void *a, const void *b) {
+    uint64_t ka = ((const CacheEntry *)a)->key, kb = ((const CacheEntry *)b)->key;
+    return ka < kb ? -1 : ka > kb;
+}
+
+long long cache_save(const char *path, const ResultCache *old, CacheEntry *added, size_t n) {
+    qsort(added, n, sizeof(CacheEntry), compare_entries);
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) return -1;
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, f);   // reescrito no final
+
+    // Intercalação das duas listas ordenadas; na mesma chave vale a antiga
+    uint64_t i = 0, count = 0;
+    size_t j = 0;
+    uint64_t last = 0;
+    while (i < old->count || j < n) {
+        const CacheEntry *e;
+        if (j == n || (i < old->count && old->entries[i].key <= added[j].key)) e = &old->entries[i++];
+        else e = &added[j++];
+        if (count > 0 && e->key == last) continue;
+        fwrite(e, sizeof(CacheEntry), 1, f);
+        last = e->key;
+        count++;
+    }
+
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    header.version = CACHE_VERSION;
+    header.header_size = sizeof(CacheHeader);
+    header.count = count;
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, f);
+    // Uma gravação curta (disco cheio) não pode substituir o cache bom
+    int failed = ferror(f);
+    if (fclose(f) != 0 || failed || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+    return (long long)count;
+}
+
+void memo_init(CacheMemo *memo) {
+    memo->slots = calloc(MEMO_INITIAL_SLOTS, sizeof(CacheEntry));
+    memo->mask = memo->slots ? MEMO_INITIAL_SLOTS - 1 : 0;
+    memo->count = 0;
+}
+
+CacheEntry *memo_find(const CacheMemo *memo, uint64_t key) {
+    if (memo->slots == NULL) return NULL;
+    for (size_t pos = key & memo->mask; memo->slots[pos].key != 0; pos = (pos + 1) & memo->mask) {
+        if (memo->slots[pos].key == key) return &memo->slots[pos];
+    }
+    return NULL;
+}
+
+static int memo_grow(CacheMemo *memo) {
+    size_t nslots = (memo->mask + 1) * 2;
+    CacheEntry *slots = calloc(nslots, sizeof(CacheEntry));
+    if (slots == NULL) return -1;
+    for (size_t i = 0; i <= memo->mask; i++) {
+        if (memo->slots[i].key == 0) continue;
+        size_t pos = memo->slots[i].key & (nslots - 1);
+        while (slots[pos].key != 0) pos = (pos + 1) & (nslots - 1);
+        slots[pos] = memo->slots[i];
+    }
+    free(memo->slots);
+    memo->slots = slots;
+    memo->mask = nslots - 1;
+    return 0;
+}
+
+CacheEntry *memo_insert(CacheMemo *memo, uint64_t key, uint8_t label) {
+    if (memo->slots == NULL) return NULL;
+    if ((memo->count + 1) * 2 > memo->mask + 1 && memo_grow(memo) < 0) return NULL;
+    size_t pos = key & memo->mask;
+    while (memo->slots[pos].key != 0 && memo->slots[pos].key != key) pos = (pos + 1) & memo->mask;
+    if (memo->slots[pos].key == 0) memo->count++;
+    memo->slots[pos].key = key;
+    memo->slots[pos].label = label;
+    return &memo->slots[pos];
+}
+
+void memo_free(CacheMemo *memo) {
+    free(memo->slots);
+    memset(memo, 0, sizeof(*memo));
+}
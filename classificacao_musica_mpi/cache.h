@@ -0,0 +1,77 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cache de sentimentos endereçado pelo conteúdo (--cache): a chave é um hash
+// de 64 bits da identidade do classificador (modelo + versão do prompt) e da
+// letra, então letras repetidas ou relançadas e reexecuções não voltam ao modelo.
+//
+// Layout: CacheHeader seguido de count CacheEntry ordenadas pela chave. Todos
+// os ranks mapeiam o arquivo (somente leitura, com mmap) e fazem busca binária;
+// ao final, o rank 0 junta os resultados novos de todos e grava um arquivo novo
+// (em path.tmp, renomeado ao final).
+
+#define CACHE_MAGIC "SPSENT01"
+#define CACHE_VERSION 1
+
+// Sentimentos guardados (0 = ainda em classificação, só na memória)
+enum {
+    CACHE_PENDING = 0,
+    CACHE_POSITIVE = 1,
+    CACHE_NEGATIVE = 2,
+    CACHE_NEUTRAL = 3,
+    CACHE_FAILED = 4      // classificador indisponível: neutro, mas não é gravado
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t count;
+} CacheHeader;
+
+typedef struct {
+    uint64_t key;
+    uint8_t label;
+    uint8_t pad[7];
+} CacheEntry;
+
+// Cache em disco, mapeado
+typedef struct {
+    void *base;
+    size_t size;
+    const CacheEntry *entries;
+    uint64_t count;
+} ResultCache;
+
+// Resultados desta execução (tabela hash em memória), inclusive os que ainda
+// estão em classificação, para que letras repetidas sejam classificadas uma vez
+typedef struct {
+    CacheEntry *slots;
+    size_t mask;
+    size_t count;
+} CacheMemo;
+
+uint64_t cache_key(const char *identity, const char *text, size_t len);
+
+uint8_t cache_label_code(const char *label);     // CACHE_FAILED se não for um sentimento
+const char *cache_label_name(uint8_t code);       // "neutro" para CACHE_FAILED
+
+// Mapeia o cache; um arquivo inexistente é um cache vazio. Retorna -1 se o
+// arquivo existe mas é inválido (o cache fica vazio).
+int cache_open(ResultCache *cache, const char *path);
+int cache_lookup(const ResultCache *cache, uint64_t key, uint8_t *label);
+void cache_close(ResultCache *cache);
+
+// Grava o cache com as entradas antigas e as n novas (ordenadas aqui). Sem MPI;
+// chamada só pelo rank 0. Retorna o total de entradas ou -1.
+long long cache_save(const char *path, const ResultCache *old, CacheEntry *added, size_t n);
+
+void memo_init(CacheMemo *memo);
+CacheEntry *memo_find(const CacheMemo *memo, uint64_t key);
+CacheEntry *memo_insert(CacheMemo *memo, uint64_t key, uint8_t label);
+void memo_free(CacheMemo *memo);
+
+#endif
@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+#include "classifier.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+int classifier_start(Classifier *c, const char *script) {
+    memset(c, 0, sizeof(*c));
+    c->to_worker = c->from_worker = -1;
+
+    // Sem isso, escrever para um coprocesso que morreu encerraria o rank com SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+
+    // O_CLOEXEC: os pipes de um canal não vazam para os coprocessos dos outros
+    // (senão o coprocesso nunca veria o fim da entrada ao ser encerrado)
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) < 0) return -1;
+    if (pipe2(out, O_CLOEXEC) < 0) {
+        close(in[0]);
+        close(in[1]);
+        return -1;
+    }
+
+    // posix_spawn em vez de fork: não duplica o processo MPI (memória registrada, threads)
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    char *argv[] = { "python3", (char *)script, "--serve", NULL };
+    int rc = posix_spawnp(&c->pid, "python3", &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(in[0]);
+    close(out[1]);
+    if (rc != 0) {
+        close(in[1]);
+        close(out[0]);
+        errno = rc;
+        return -1;
+    }
+
+    c->to_worker = in[1];
+    c->from_worker = out[0];
+    c->alive = 1;
+    return 0;
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int write_u32(int fd, size_t value) {
+    unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16),
+                               (unsigned char)(value >> 8), (unsigned char)value };
+    return write_all(fd, bytes, 4);
+}
+
+static int read_u32(int fd, size_t *value) {
+    unsigned char bytes[4];
+    if (read_all(fd, bytes, 4) < 0) return -1;
+    *value = ((size_t)bytes[0] << 24) | ((size_t)bytes[1] << 16) | ((size_t)bytes[2] << 8) | bytes[3];
+    return 0;
+}
+
+// O coprocesso morreu ou quebrou o protocolo: encerra-o de vez
+static void worker_failed(Classifier *c) {
+    c->alive = 0;
+    classifier_stop(c);
+}
+
+// Lê um quadro de até size - 1 bytes como string
+static int read_string(int fd, char *buf, size_t size) {
+    size_t len;
+    if (read_u32(fd, &len) < 0 || len >= size || read_all(fd, buf, len) < 0) return -1;
+    buf[len] = '\0';
+    return 0;
+}
+
+int classifier_hello(Classifier *c, char *identity, size_t size) {
+    if (!c->alive) return -1;
+    if (read_string(c->from_worker, identity, size) < 0) {
+        worker_failed(c);
+        return -1;
+    }
+    return 0;
+}
+
+int classifier_send_batch(Classifier *c, const char *const *texts, const size_t *lens, int n) {
+    if (!c->alive) return -1;
+    // O coprocesso lê o lote inteiro antes de responder, então a escrita não
+    // trava enquanto ele não tiver outro lote pendente neste canal
+    int ok = write_u32(c->to_worker, (size_t)n) == 0;
+    for (int i = 0; ok && i < n; i++) {
+        ok = lens[i] <= UINT32_MAX && write_u32(c->to_worker, lens[i]) == 0 &&
+             write_all(c->to_worker, texts[i], lens[i]) == 0;
+    }
+    if (!ok) {
+        worker_failed(c);
+        return -1;
+    }
+    return 0;
+}
+
+int classifier_wait(Classifier *c, int timeout_ms) {
+    if (!c->alive) return 1;
+    struct pollfd pfd = { c->from_worker, POLLIN, 0 };
+    int r;
+    do {
+        r = poll(&pfd, 1, timeout_ms);
+    } while (r < 0 && errno == EINTR);
+    return r != 0;
+}
+
+int classifier_receive_batch(Classifier *c, int n, char (*labels)[CLASSIFIER_MAX_LABEL]) {
+    if (!c->alive) return -1;
+    size_t count;
+    if (read_u32(c->from_worker, &count) < 0 || count != (size_t)n) {
+        worker_failed(c);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (read_string(c->from_worker, labels[i], CLASSIFIER_MAX_LABEL) < 0) {
+            worker_failed(c);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void classifier_stop(Classifier *c) {
+    if (c->to_worker >= 0) close(c->to_worker);
+    if (c->from_worker >= 0) close(c->from_worker);
+    c->to_worker = c->from_worker = -1;
+    if (c->pid > 0) {
+        if (!c->alive) kill(c->pid, SIGTERM);   // com defeito: não espera ele ler o fim da entrada
+        while (waitpid(c->pid, NULL, 0) < 0 && errno == EINTR) {}
+    }
+    c->pid = 0;
+    c->alive = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef CLASSIFIER_H
+#define CLASSIFIER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Classificador persistente: cada rank inicia um único processo
+// "python3 classify_ollama.py --serve" e conversa com ele por pipes, em vez de
+// iniciar o Python (importar o ollama, abrir o cliente) a cada música.
+//
+// Protocolo (stdin/stdout do coprocesso): os pedidos são lotes. Um lote é a
+// quantidade N em 4 bytes big-endian seguida de N quadros, cada um com o
+// tamanho do conteúdo em 4 bytes big-endian e o conteúdo em UTF-8 (a letra). A
+// resposta tem o mesmo formato, com N sentimentos ("positivo", "negativo" ou
+// "neutro", ou "erro" para uma letra que o modelo não classificou) na ordem das
+// letras. Os lotes são respondidos na ordem em que chegam. Ao
+// iniciar, o coprocesso envia um quadro com a sua identidade (modelo e versão
+// dos prompts).
+//
+// Cada coprocesso atende um lote por vez; para ter vários pedidos em
+// andamento, o rank usa vários Classifier (canais), cada um com um lote.
+
+#define CLASSIFIER_MAX_LABEL 128
+#define CLASSIFIER_MAX_IDENTITY 256
+
+typedef struct {
+    pid_t pid;
+    int to_worker;      // stdin do coprocesso
+    int from_worker;    // stdout do coprocesso
+    int alive;
+} Classifier;
+
+// Inicia o coprocesso com o script dado. Retorna 0 ou -1.
+int classifier_start(Classifier *c, const char *script);
+
+// Lê o quadro de identidade (só depois de classifier_start; a leitura espera o
+// Python iniciar, então com vários canais convém iniciar todos antes). Retorna 0 ou -1.
+int classifier_hello(Classifier *c, char *identity, size_t size);
+
+// Envia as n letras texts[i][0..lens[i]) como um lote, sem esperar a
+// resposta; vários coprocessos podem assim classificar ao mesmo tempo. Retorna
+// 0 ou -1 se o coprocesso não aceita o pedido.
+int classifier_send_batch(Classifier *c, const char *const *texts, const size_t *lens, int n);
+
+// Espera até timeout_ms pela resposta ao lote enviado, sem lê-la. Retorna 1 se
+// há dados (ou o coprocesso encerrou: classifier_receive_batch trata disso) e
+// 0 se o tempo acabou.
+int classifier_wait(Classifier *c, int timeout_ms);
+
+// Recebe a resposta ao lote enviado antes (de n letras) e copia o sentimento de
+// cada letra em labels[i]. Retorna 0 ou -1 se o coprocesso não responde ou
+// responde com outra quantidade de sentimentos. Nas duas funções, uma falha
+// encerra o coprocesso e as chamadas seguintes também falham.
+int classifier_receive_batch(Classifier *c, int n, char (*labels)[CLASSIFIER_MAX_LABEL]);
+
+// Fecha os pipes (o coprocesso termina ao ver o fim da entrada) e espera o processo
+void classifier_stop(Classifier *c);
+
+#endif
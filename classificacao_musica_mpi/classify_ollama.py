@@ -5,14 +5,29 @@ classify_ollama.py
 Usage:
   python3 classify_ollama.py --text "some lyrics..." 
   python3 classify_ollama.py --file /tmp/lyrics.txt
+  python3 classify_ollama.py --serve
 
 Outputs a single word on stdout: "positivo", "negativo" ou "neutro"
+
+Com --serve, o processo fica ativo e atende pedidos em sequência por
+stdin/stdout (usado pelo sentiment_mpi, um processo por rank). Cada pedido é um
+lote: a quantidade N em 4 bytes big-endian seguida de N quadros (tamanho em 4
+bytes big-endian + conteúdo UTF-8), um por letra. A resposta tem o mesmo
+formato, com N quadros de sentimento na ordem das letras; FAILED_LABEL no
+lugar do sentimento marca uma letra que não pôde ser classificada (Ollama
+indisponível), que o sentiment_mpi grava como neutra mas não guarda no cache.
+Antes do primeiro
+pedido, o processo envia um quadro com a sua identidade (modelo e versão dos
+prompts), que o sentiment_mpi usa nas chaves do cache de resultados.
 """
 
 import argparse
 import sys
 import os
-from typing import Optional
+import re
+import struct
+from concurrent.futures import ThreadPoolExecutor
+from typing import List, Optional
 
 try:
     from ollama import chat
@@ -20,28 +35,34 @@ except Exception as e:
     sys.stderr.write("Erro: não foi possível importar 'ollama'. Instale com `pip install ollama`.\n")
     sys.exit(2)
 
-def classify_text(text: str) -> str:
-    """
-    Envia `text` para o modelo gemma3:1b via Ollama e pede a classificação.
-    Retorna 'positivo', 'negativo' ou 'neutro'.
-    """
-    system_prompt = (
-        "Você é um classificador de sentimento. "
-        "Receberá a letra de uma música e deve responder com EXATAMENTE uma palavra: "
-        "'positivo', 'negativo' ou 'neutro'. "
-        "Responda apenas essa palavra, sem explicações, sem pontuação extra."
-    )
-
-    user_prompt = f"Classifique o seguinte texto quanto ao sentimento (positivo/negativo/neutro):\n\n\"\"\"\n{text}\n\"\"\""
-
+MODEL = 'gemma3:1b'
+# Incrementar ao mudar os prompts: invalida os resultados em cache do sentiment_mpi.
+# Versão 2: as falhas do Ollama deixaram de voltar como 'neutro' (e de ir para o cache).
+PROMPT_VERSION = 2
+# Resposta do modo --serve para uma letra não classificada
+FAILED_LABEL = 'erro'
+
+LABELS = {
+    'positive': 'positivo',
+    'negative': 'negativo',
+    'neutral': 'neutro',
+    'positivo': 'positivo',
+    'negativo': 'negativo',
+    'positiva': 'positivo',
+    'negativa': 'negativo',
+    'neutro': 'neutro',
+    'neutra': 'neutro'
+}
+
+def ask_model(system_prompt: str, user_prompt: str) -> str:
+    """Faz uma consulta ao modelo e retorna o texto da resposta."""
     try:
-        resp = chat(model='gemma3:1b', messages=[
+        resp = chat(model=MODEL, messages=[
             {'role': 'system', 'content': system_prompt},
             {'role': 'user', 'content': user_prompt}
         ])
     except Exception as e:
-        sys.stderr.write(f"Erro ao consultar Ollama: {e}\n")
-        sys.exit(3)
+        raise RuntimeError(f"Erro ao consultar Ollama: {e}")
 
     content = ""
     if isinstance(resp, dict) and 'message' in resp:
@@ -53,42 +74,149 @@ def classify_text(text: str) -> str:
             content = resp.message.content
         except Exception:
             content = str(resp)
+    return content
 
-    content = content.strip().splitlines()[0].strip().lower()
-
-    map_ok = {
-        'positive': 'positivo',
-        'negative': 'negativo',
-        'neutral': 'neutro',
-        'positivo': 'positivo',
-        'negativo': 'negativo',
-        'positiva': 'positivo',
-        'negativa': 'negativo',
-        'neutro': 'neutro',
-        'neutra': 'neutro'
-    }
-
+def parse_label(content: str) -> Optional[str]:
+    """Sentimento de uma resposta curta, ou None se não for reconhecido."""
+    content = content.strip().lower()
     token = content.split()[0] if content else ''
-    resultado = map_ok.get(token, None)
-
+    resultado = LABELS.get(token, None)
     if resultado is None:
         if 'positivo' in content or 'positive' in content:
             resultado = 'positivo'
         elif 'negativo' in content or 'negative' in content:
             resultado = 'negativo'
-        else:
+        elif 'neutro' in content or 'neutral' in content:
             resultado = 'neutro'
-
-    print(resultado)
     return resultado
 
+def classify_text(text: str) -> str:
+    """
+    Envia `text` para o modelo gemma3:1b via Ollama e pede a classificação.
+    Retorna 'positivo', 'negativo' ou 'neutro'.
+    """
+    system_prompt = (
+        "Você é um classificador de sentimento. "
+        "Receberá a letra de uma música e deve responder com EXATAMENTE uma palavra: "
+        "'positivo', 'negativo' ou 'neutro'. "
+        "Responda apenas essa palavra, sem explicações, sem pontuação extra."
+    )
+
+    user_prompt = f"Classifique o seguinte texto quanto ao sentimento (positivo/negativo/neutro):\n\n\"\"\"\n{text}\n\"\"\""
+
+    lines = ask_model(system_prompt, user_prompt).strip().splitlines()
+    resultado = parse_label(lines[0]) if lines else None
+    return resultado or 'neutro'
+
+def classify_batch(texts: List[str]) -> List[str]:
+    """
+    Classifica várias letras com uma única consulta: o modelo responde uma
+    linha "número: sentimento" por letra. Se a resposta não tiver exatamente
+    um sentimento reconhecido para cada número, as letras são classificadas
+    uma a uma, com as consultas em paralelo (o servidor do Ollama as atende
+    juntas).
+    """
+    if len(texts) == 1:
+        return [classify_text(texts[0])]
+
+    n = len(texts)
+    system_prompt = (
+        "Você é um classificador de sentimento. "
+        f"Receberá {n} letras de músicas numeradas de 1 a {n} e deve responder com "
+        f"EXATAMENTE {n} linhas, uma por letra, no formato '<número>: <sentimento>', "
+        "onde o sentimento é 'positivo', 'negativo' ou 'neutro'. "
+        "Responda apenas essas linhas, sem explicações."
+    )
+    parts = [f"Classifique cada uma das {n} letras abaixo quanto ao sentimento (positivo/negativo/neutro):"]
+    for i, text in enumerate(texts, 1):
+        parts.append(f"Letra {i}:\n\"\"\"\n{text}\n\"\"\"")
+    user_prompt = "\n\n".join(parts)
+
+    labels: List[Optional[str]] = [None] * n
+    for line in ask_model(system_prompt, user_prompt).splitlines():
+        match = re.match(r'\W*(?:letra\s*)?(\d+)\s*[:.)\-]\s*(.+)', line.strip(), re.IGNORECASE)
+        if match is None:
+            continue
+        index = int(match.group(1)) - 1
+        label = parse_label(match.group(2))
+        if 0 <= index < n and label is not None:
+            if labels[index] is not None and labels[index] != label:
+                labels = []   # número repetido com respostas diferentes: resposta inválida
+                break
+            labels[index] = label
+
+    if len(labels) == n and all(label is not None for label in labels):
+        return labels
+
+    with ThreadPoolExecutor(max_workers=n) as pool:
+        return list(pool.map(classify_or_failed, texts))
+
+def classify_or_failed(text: str) -> str:
+    """classify_text, com uma falha do Ollama virando FAILED_LABEL."""
+    try:
+        return classify_text(text)
+    except RuntimeError as e:
+        sys.stderr.write(f"{e}\n")
+        return FAILED_LABEL
+
+def read_frame(stream) -> Optional[bytes]:
+    """Lê um quadro (tamanho + conteúdo); None no fim da entrada."""
+    header = stream.read(4)
+    if len(header) < 4:
+        return None
+    (size,) = struct.unpack('>I', header)
+    data = stream.read(size)
+    if len(data) < size:
+        return None
+    return data
+
+def write_frame(stream, data: bytes) -> None:
+    stream.write(struct.pack('>I', len(data)))
+    stream.write(data)
+
+def read_count(stream) -> Optional[int]:
+    header = stream.read(4)
+    if len(header) < 4:
+        return None
+    return struct.unpack('>I', header)[0]
+
+def serve() -> None:
+    """Atende lotes até o fim da entrada; uma falha do Ollama vira FAILED_LABEL."""
+    stdin, stdout = sys.stdin.buffer, sys.stdout.buffer
+    write_frame(stdout, f"{MODEL}/prompt-v{PROMPT_VERSION}".encode('utf-8'))
+    stdout.flush()
+    while True:
+        count = read_count(stdin)
+        if count is None:
+            break
+        texts = []
+        for _ in range(count):
+            request = read_frame(stdin)
+            if request is None:
+                return
+            texts.append(request.decode('utf-8', errors='replace'))
+        try:
+            labels = classify_batch(texts) if texts else []
+        except RuntimeError as e:
+            sys.stderr.write(f"{e}\n")
+            labels = [FAILED_LABEL] * count
+        stdout.write(struct.pack('>I', len(labels)))
+        for label in labels:
+            write_frame(stdout, label.encode('utf-8'))
+        stdout.flush()
+
 def main():
     ap = argparse.ArgumentParser()
     group = ap.add_mutually_exclusive_group(required=True)
     group.add_argument('--text', type=str, help='Texto a classificar (pode conter espaços).')
     group.add_argument('--file', type=str, help='Caminho para arquivo contendo o texto (UTF-8).')
+    group.add_argument('--serve', action='store_true', help='Atende pedidos em quadros por stdin/stdout.')
     args = ap.parse_args()
 
+    if args.serve:
+        serve()
+        return
+
     if args.file:
         if not os.path.exists(args.file):
             sys.stderr.write(f"Arquivo não encontrado: {args.file}\n")
@@ -98,7 +226,11 @@ def main():
     else:
         text = args.text
 
-    classify_text(text)
+    try:
+        print(classify_text(text))
+    except RuntimeError as e:
+        sys.stderr.write(f"{e}\n")
+        sys.exit(3)
 
 if __name__ == '__main__':
     main()
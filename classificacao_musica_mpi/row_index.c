@@ -0,0 +1,103 @@
+#include "row_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int row_index_read(MPI_File fh, MPI_Offset begin, MPI_Offset end, char *buf) {
+    // Em blocos, pois a contagem do MPI é int
+    const MPI_Offset max_block = 1 << 30;
+    while (begin < end) {
+        int n = (int)(end - begin < max_block ? end - begin : max_block);
+        MPI_Status status;
+        int got = 0;
+        if (MPI_File_read_at(fh, begin, buf, n, MPI_CHAR, &status) != MPI_SUCCESS) return -1;
+        MPI_Get_count(&status, MPI_CHAR, &got);
+        if (got != n) return -1;
+        begin += n;
+        buf += n;
+    }
+    return 0;
+}
+
+// Paridade (0 ou 1) do número de aspas em buf[0..len)
+static int quote_parity(const char *buf, size_t len) {
+    int parity = 0;
+    const char *end = buf + len;
+    for (const char *q = memchr(buf, '"', len); q != NULL; q = memchr(q + 1, '"', (size_t)(end - q - 1))) {
+        parity ^= 1;
+    }
+    return parity;
+}
+
+int row_index_build(MPI_File fh, RowIndex *index) {
+    int rank, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    memset(index, 0, sizeof(*index));
+
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+    MPI_Offset start = file_size * rank / nprocs, end = file_size * (rank + 1) / nprocs;
+    size_t len = (size_t)(end - start);
+    char *buf = malloc(len > 0 ? len : 1);
+    int ok = buf != NULL && row_index_read(fh, start, end, buf) == 0;
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    if (!ok) {
+        free(buf);
+        return -1;
+    }
+
+    // Estado das aspas no início da faixa: XOR das paridades das faixas anteriores
+    int parity = quote_parity(buf, len), in_quotes = 0;
+    MPI_Exscan(&parity, &in_quotes, 1, MPI_INT, MPI_BXOR, MPI_COMM_WORLD);
+    if (rank == 0) in_quotes = 0;
+
+    // Inícios de registro: logo após cada '\n' fora de aspas desta faixa
+    MPI_Offset *starts = NULL;
+    size_t n = 0, capacity = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == '"') {
+            in_quotes ^= 1;
+        } else if (buf[i] == '\n' && !in_quotes && start + (MPI_Offset)i + 1 < file_size) {
+            if (n == capacity) {
+                capacity = capacity ? capacity * 2 : 1024;
+                MPI_Offset *grown = realloc(starts, capacity * sizeof(MPI_Offset));
+                if (grown == NULL) {
+                    fprintf(stderr, "[rank %d] Erro: memória insuficiente no índice\n", rank);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                starts = grown;
+            }
+            starts[n++] = start + (MPI_Offset)i + 1;
+        }
+    }
+    free(buf);
+
+    // Junta os inícios de todos os ranks, já em ordem de arquivo
+    int mine = (int)n;
+    int *counts = malloc(sizeof(int) * nprocs), *displs = malloc(sizeof(int) * nprocs);
+    MPI_Allgather(&mine, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+    long total = 0;
+    for (int r = 0; r < nprocs; r++) {
+        displs[r] = (int)total;
+        total += counts[r];
+    }
+    index->offsets = malloc(sizeof(MPI_Offset) * (total + 1));
+    if (index->offsets == NULL) {
+        fprintf(stderr, "[rank %d] Erro: memória insuficiente no índice\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Allgatherv(starts, mine, MPI_OFFSET, index->offsets, counts, displs, MPI_OFFSET, MPI_COMM_WORLD);
+    index->offsets[total] = file_size;
+    index->count = total;
+    free(starts);
+    free(counts);
+    free(displs);
+    return 0;
+}
+
+void row_index_free(RowIndex *index) {
+    free(index->offsets);
+    memset(index, 0, sizeof(*index));
+}
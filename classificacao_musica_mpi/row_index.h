@@ -0,0 +1,32 @@
+#ifndef ROW_INDEX_H
+#define ROW_INDEX_H
+
+#include <mpi.h>
+#include <stddef.h>
+
+// Índice das músicas de um CSV, construído uma vez e em conjunto pelos ranks
+// com MPI-IO: cada rank lê só uma faixa de bytes do arquivo (uma única vez) e
+// procura nela os inícios de registro. Campos entre aspas podem conter quebras
+// de linha (RFC 4180), então um registro termina no primeiro '\n' fora de
+// aspas; o estado das aspas no início de cada faixa vem da paridade das aspas
+// das faixas anteriores (MPI_Exscan com XOR).
+//
+// offsets[i] é o início da música i e offsets[count] o tamanho do arquivo; o
+// cabeçalho é [0, offsets[0]) (o arquivo inteiro se count == 0). Cada música
+// inclui o seu terminador de linha; linhas em branco também são registros.
+
+typedef struct {
+    MPI_Offset *offsets;
+    long count;
+} RowIndex;
+
+// Operação coletiva; o índice completo fica em todos os ranks. Retorna 0 ou -1
+// (em todos os ranks) se a leitura falhar.
+int row_index_build(MPI_File fh, RowIndex *index);
+
+// Lê os bytes [begin, end) do arquivo em buf (chamada independente). Retorna 0 ou -1.
+int row_index_read(MPI_File fh, MPI_Offset begin, MPI_Offset end, char *buf);
+
+void row_index_free(RowIndex *index);
+
+#endif
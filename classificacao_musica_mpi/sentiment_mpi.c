@@ -3,105 +3,539 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "classifier.h"
+#include "corpus.h"
+#include "csv.h"
+#include "row_index.h"
 
-#define MAXLINE 65536
 #define MAXFIELDS 256
-#define TMPDIR "/tmp"
-
-int parse_csv_line(const char *line, char **fields, int maxfields) {
-    const char *p = line;
-    int field = 0;
-    while (*p && field < maxfields) {
-        if (*p == '"') {
-            p++;
-            const char *start = p;
-            char *buf = malloc(MAXLINE);
-            if (!buf) return -1;
-            int idx = 0;
-            while (*p) {
-                if (*p == '"') {
-                    if (*(p+1) == '"') {
-                        buf[idx++] = '"';
-                        p += 2;
-                    } else {
-                        p++;
-                        break;
-                    }
-                } else {
-                    buf[idx++] = *p;
-                    p++;
-                }
-            }
-            buf[idx] = '\0';
-            fields[field++] = buf;
-            while (*p && *p != ',') p++;
-            if (*p == ',') p++;
+#define CLASSIFIER_SCRIPT "classify_ollama.py"
+#define DEFAULT_BATCH_SIZE 8
+#define MAX_BATCH_SIZE 256
+#define DEFAULT_DEPTH 1
+#define MAX_DEPTH 64
+#define DEFAULT_PROGRESS_INTERVAL 10.0
+#define PROGRESS_FIELDS 4   // positivo, negativo, neutro, total
+#define PROGRESS_SLOT (PROGRESS_FIELDS + 1)   // contagens + "terminou", por rank
+#define PROGRESS_POLL_US 100000
+
+// Separa a linha em campos sem cópia: desfaz as aspas e termina cada campo em
+// '\0' na própria linha, então os campos valem enquanto a linha existir
+int split_csv_line(char *line, size_t len, char **fields, int maxfields) {
+    CsvField views[MAXFIELDS];
+    int nf = csv_split(line, len, views, maxfields < MAXFIELDS ? maxfields : MAXFIELDS);
+    for (int i = 0; i < nf; ++i) {
+        fields[i] = csv_field_unescape(&views[i]);
+        fields[i][views[i].len] = '\0';
+    }
+    return nf;
+}
+
+// De onde vem o sentimento de uma música
+enum {
+    ROW_INFER,      // enviada ao classificador
+    ROW_CACHED,     // encontrada no cache em disco
+    ROW_REPEAT      // mesma letra de uma música anterior desta execução
+};
+
+// Progresso global sem sincronizar os ranks: cada rank publica as suas
+// contagens em uma janela RMA do rank 0 (MPI_Accumulate com MPI_REPLACE,
+// acesso passivo, então o rank 0 não precisa atender pedidos), e o rank 0
+// soma as publicações e imprime o resumo. Os dois lados agem em intervalos de
+// tempo, independentemente de quantas músicas cada rank já processou; o rank 0
+// também imprime enquanto espera o classificador e, depois de terminar a sua
+// parte, até que todos os ranks tenham publicado o fim.
+typedef struct {
+    int enabled;
+    MPI_Win win;
+    long *slots;            // no rank 0: PROGRESS_SLOT valores por rank
+    int nprocs;
+    double interval;
+    double last_publish, last_report;
+} Progress;
+
+void progress_init(Progress *p, double interval, int rank, int nprocs) {
+    memset(p, 0, sizeof(*p));
+    p->enabled = interval > 0;
+    if (!p->enabled) return;
+    p->interval = interval;
+    p->nprocs = nprocs;
+    MPI_Aint size = rank == 0 ? (MPI_Aint)(sizeof(long) * PROGRESS_SLOT * nprocs) : 0;
+    MPI_Win_allocate(size, sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD, &p->slots, &p->win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, p->win);
+        memset(p->slots, 0, (size_t)size);
+        MPI_Win_unlock(0, p->win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, p->win);
+    p->last_publish = p->last_report = MPI_Wtime();
+}
+
+static void progress_publish(Progress *p, int rank, const long counts[PROGRESS_FIELDS], int done) {
+    long slot[PROGRESS_SLOT];
+    memcpy(slot, counts, sizeof(long) * PROGRESS_FIELDS);
+    slot[PROGRESS_FIELDS] = done;
+    MPI_Accumulate(slot, PROGRESS_SLOT, MPI_LONG, 0, (MPI_Aint)rank * PROGRESS_SLOT,
+                   PROGRESS_SLOT, MPI_LONG, MPI_REPLACE, p->win);
+    MPI_Win_flush(0, p->win);
+}
+
+// Só no rank 0: lê as publicações, imprime o resumo se o intervalo passou e
+// retorna quantos ranks já terminaram
+static int progress_report(Progress *p) {
+    int n = PROGRESS_SLOT * p->nprocs;
+    long *all = malloc(sizeof(long) * n);
+    if (!all) return 0;
+    MPI_Get_accumulate(NULL, 0, MPI_LONG, all, n, MPI_LONG, 0, 0, n, MPI_LONG, MPI_NO_OP, p->win);
+    MPI_Win_flush(0, p->win);
+    long sum[PROGRESS_FIELDS] = { 0, 0, 0, 0 };
+    int done = 0;
+    for (int r = 0; r < p->nprocs; ++r) {
+        for (int f = 0; f < PROGRESS_FIELDS; ++f) sum[f] += all[r * PROGRESS_SLOT + f];
+        done += all[r * PROGRESS_SLOT + PROGRESS_FIELDS] != 0;
+    }
+    free(all);
+    double now = MPI_Wtime();
+    if (now - p->last_report >= p->interval) {
+        printf("\n[global] Resumo após %ld músicas: Positivo = %ld, Negativo = %ld, Neutro = %ld\n\n",
+               sum[3], sum[0], sum[1], sum[2]);
+        fflush(stdout);
+        p->last_report = now;
+    }
+    return done;
+}
+
+// Chamada a cada música gravada; só comunica quando o intervalo passou
+void progress_update(Progress *p, int rank, const long counts[PROGRESS_FIELDS]) {
+    if (!p->enabled) return;
+    double now = MPI_Wtime();
+    if (now - p->last_publish >= p->interval) {
+        progress_publish(p, rank, counts, 0);
+        p->last_publish = now;
+    }
+    if (rank == 0 && now - p->last_report >= p->interval) progress_report(p);
+}
+
+// Milissegundos até o próximo resumo do rank 0 (-1: sem progresso, espera sem limite)
+int progress_timeout_ms(const Progress *p, int rank) {
+    if (!p->enabled || rank != 0) return -1;
+    double left = p->last_report + p->interval - MPI_Wtime();
+    return left > 0 ? (int)(left * 1000) + 1 : 0;
+}
+
+// Chamada pelo rank 0 enquanto espera (o classificador, por exemplo)
+void progress_poll(Progress *p, int rank) {
+    if (!p->enabled || rank != 0) return;
+    if (MPI_Wtime() - p->last_report >= p->interval) progress_report(p);
+}
+
+// Publica as contagens finais do rank; o rank 0 continua imprimindo os resumos
+// até que todos os ranks tenham terminado
+void progress_finish(Progress *p, int rank, const long counts[PROGRESS_FIELDS]) {
+    if (!p->enabled) return;
+    progress_publish(p, rank, counts, 1);
+    if (rank != 0) return;
+    while (progress_report(p) < p->nprocs) usleep(PROGRESS_POLL_US);
+}
+
+// Coletiva: chamada por todos os ranks depois de progress_finish
+void progress_free(Progress *p) {
+    if (!p->enabled) return;
+    MPI_Win_unlock_all(p->win);
+    MPI_Win_free(&p->win);
+}
+
+// Música aguardando classificação em um lote
+typedef struct {
+    char *fields[MAXFIELDS];
+    int nf;
+    long line_index;
+    uint64_t key;       // chave da letra no cache
+    int source;
+    uint8_t label;      // sentimento, se source == ROW_CACHED
+} PendingRow;
+
+// Lote de músicas: em preenchimento ou enviado ao canal de mesmo índice
+typedef struct {
+    PendingRow *rows;
+    int n;
+    int requested;      // letras enviadas ao classificador (as ROW_INFER)
+    int sent;           // o canal aceitou o pedido
+} Batch;
+
+// Estado de classificação de cada rank: colunas de interesse, canais de
+// classificação, lotes em andamento, arquivo parcial e contagens.
+//
+// Com depth canais, até depth lotes ficam em classificação ao mesmo tempo. Os
+// lotes usam os slots (e canais) em rodízio a partir de oldest; o próximo a
+// preencher é o slot oldest + inflight. Como as respostas são recebidas do
+// lote mais antigo para o mais novo, as músicas são gravadas na ordem de entrada.
+typedef struct {
+    int rank;
+    int text_col_index, artist_col_index, song_col_index;
+    Classifier *channels;
+    Batch *slots;
+    int depth, batch_size;
+    int oldest, inflight;
+    const char *identity;   // modelo e versão dos prompts, parte da chave do cache
+    const ResultCache *cache;
+    CacheMemo memo;
+    CacheEntry *added;      // resultados novos deste rank, para gravar no cache
+    size_t added_count, added_capacity;
+    long cache_hits, repeat_hits, misses;
+    Progress *progress;
+    FILE *fout;
+    long cnt_pos, cnt_neg, cnt_neu, cnt_total;
+} RowContext;
+
+static char *row_field(const PendingRow *row, int index) {
+    return index < row->nf && row->fields[index] ? row->fields[index] : "";
+}
+
+// Grava um campo CSV, entre aspas (com "" escapado) se tiver vírgula, aspas ou
+// quebra de linha, para que cada música continue sendo um único registro
+void write_csv_field(FILE *fout, const char *field) {
+    if (strpbrk(field, ",\"\r\n") == NULL) {
+        fputs(field, fout);
+        return;
+    }
+    fputc('"', fout);
+    for (const char *c = field; *c; ++c) {
+        if (*c == '"') fputc('"', fout);
+        fputc(*c, fout);
+    }
+    fputc('"', fout);
+}
+
+// Grava a linha com o sentimento no arquivo parcial do rank e atualiza as contagens
+void write_row(char **fields, int nf, const char *sentiment, RowContext *ctx) {
+    int rank = ctx->rank;
+    char *artist_field = (ctx->artist_col_index < nf) ? fields[ctx->artist_col_index] : "";
+    char *song_field = (ctx->song_col_index < nf) ? fields[ctx->song_col_index] : "";
+
+    printf("[rank %d] Artista: %s | Música: %s | Sentimento: %s\n", rank, artist_field, song_field, sentiment);
+
+    if (strcmp(sentiment, "positivo") == 0) ctx->cnt_pos++;
+    else if (strcmp(sentiment, "negativo") == 0) ctx->cnt_neg++;
+    else ctx->cnt_neu++;
+
+    FILE *fout = ctx->fout;
+    for (int i = 0; i < nf; ++i) {
+        if (i) fprintf(fout, ",");
+        if (fields[i]) write_csv_field(fout, fields[i]);
+    }
+    fprintf(fout, ",%s\n", sentiment);
+
+    ctx->cnt_total++;
+    long counts[PROGRESS_FIELDS] = { ctx->cnt_pos, ctx->cnt_neg, ctx->cnt_neu, ctx->cnt_total };
+    progress_update(ctx->progress, rank, counts);
+}
+
+static void channel_failed(RowContext *ctx, int channel, const Batch *b) {
+    fprintf(stderr, "[rank %d] Classificador %d encerrou no lote da linha %ld; restantes do canal ficam neutras\n",
+            ctx->rank, channel, b->rows[0].line_index);
+}
+
+// Guarda um resultado novo para o cache em disco
+static void add_result(RowContext *ctx, uint64_t key, uint8_t label) {
+    if (ctx->added_count == ctx->added_capacity) {
+        size_t capacity = ctx->added_capacity ? ctx->added_capacity * 2 : 1024;
+        CacheEntry *added = realloc(ctx->added, capacity * sizeof(CacheEntry));
+        if (!added) return;   // sem memória, o resultado só não é guardado
+        ctx->added = added;
+        ctx->added_capacity = capacity;
+    }
+    CacheEntry *e = &ctx->added[ctx->added_count++];
+    memset(e, 0, sizeof(*e));
+    e->key = key;
+    e->label = label;
+}
+
+// Envia o lote em preenchimento ao seu canal, sem esperar a resposta
+void dispatch_batch(RowContext *ctx) {
+    int slot = (ctx->oldest + ctx->inflight) % ctx->depth;
+    Batch *b = &ctx->slots[slot];
+    if (b->n == 0) return;
+    // Só as letras que não saíram do cache vão para o classificador
+    const char *texts[MAX_BATCH_SIZE];
+    size_t lens[MAX_BATCH_SIZE];
+    b->requested = 0;
+    for (int i = 0; i < b->n; ++i) {
+        if (b->rows[i].source != ROW_INFER) continue;
+        texts[b->requested] = row_field(&b->rows[i], ctx->text_col_index);
+        lens[b->requested] = strlen(texts[b->requested]);
+        b->requested++;
+    }
+    b->sent = 1;
+    if (b->requested > 0) {
+        Classifier *channel = &ctx->channels[slot];
+        int was_alive = channel->alive;
+        b->sent = classifier_send_batch(channel, texts, lens, b->requested) == 0;
+        if (!b->sent && was_alive) channel_failed(ctx, slot, b);
+    }
+    ctx->inflight++;
+}
+
+// Recebe os sentimentos do lote mais antigo e grava as músicas dele em ordem
+void complete_oldest(RowContext *ctx) {
+    int slot = ctx->oldest;
+    Batch *b = &ctx->slots[slot];
+    char (*labels)[CLASSIFIER_MAX_LABEL] = malloc(sizeof(*labels) * (b->requested + 1));
+    if (!labels) {
+        fprintf(stderr, "[rank %d] Erro: memória insuficiente\n", ctx->rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Sem resposta do classificador (Python/Ollama indisponível), as músicas
+    // ficam neutras, e esse resultado não vai para o cache
+    int failed = 0;
+    if (b->requested > 0 && b->sent) {
+        // O rank 0 continua imprimindo o progresso global enquanto espera
+        Classifier *channel = &ctx->channels[slot];
+        while (classifier_wait(channel, progress_timeout_ms(ctx->progress, ctx->rank)) == 0) {
+            progress_poll(ctx->progress, ctx->rank);
+        }
+    }
+    if (b->requested > 0 &&
+        (!b->sent || classifier_receive_batch(&ctx->channels[slot], b->requested, labels) != 0)) {
+        if (b->sent) channel_failed(ctx, slot, b);
+        failed = 1;
+    }
+
+    int next_label = 0;
+    for (int i = 0; i < b->n; ++i) {
+        PendingRow *row = &b->rows[i];
+        const char *sentiment;
+        if (row->source == ROW_INFER) {
+            // "erro" (o modelo não respondeu) ou qualquer outra resposta que
+            // não seja um sentimento vira CACHE_FAILED: neutra, fora do cache
+            uint8_t code = failed ? CACHE_FAILED : cache_label_code(labels[next_label]);
+            next_label++;
+            sentiment = cache_label_name(code);
+            memo_insert(&ctx->memo, row->key, code);
+            if (code != CACHE_FAILED) add_result(ctx, row->key, code);
+        } else if (row->source == ROW_CACHED) {
+            sentiment = cache_label_name(row->label);
         } else {
-            const char *start = p;
-            const char *comma = strchr(p, ',');
-            size_t len = comma ? (size_t)(comma - start) : strlen(start);
-            char *buf = malloc(len + 1);
-            if (!buf) return -1;
-            strncpy(buf, start, len);
-            buf[len] = '\0';
-            fields[field++] = buf;
-            if (comma) p = comma + 1;
-            else p += len;
+            // A primeira ocorrência está em um lote anterior ou antes neste, já concluída
+            CacheEntry *first = memo_find(&ctx->memo, row->key);
+            sentiment = cache_label_name(first ? first->label : CACHE_FAILED);
         }
+        write_row(row->fields, row->nf, sentiment, ctx);
     }
-    return field;
+    free(labels);
+    b->n = 0;
+    ctx->oldest = (slot + 1) % ctx->depth;
+    ctx->inflight--;
 }
 
-void free_fields(char **fields, int n) {
-    for (int i = 0; i < n; ++i) {
-        if (fields[i]) free(fields[i]);
+// Acrescenta uma música (campos já separados) ao lote em preenchimento, que é
+// enviado ao completar batch_size músicas. Se todos os canais estão ocupados,
+// antes espera o lote mais antigo. Usada tanto para o CSV quanto para o corpus binário.
+void queue_row(char **fields, int nf, long line_index, RowContext *ctx) {
+    if (ctx->inflight == ctx->depth) complete_oldest(ctx);
+    Batch *b = &ctx->slots[(ctx->oldest + ctx->inflight) % ctx->depth];
+    PendingRow *row = &b->rows[b->n++];
+    memcpy(row->fields, fields, sizeof(char *) * nf);
+    row->nf = nf;
+    row->line_index = line_index;
+
+    // Cache em disco, depois letras já vistas nesta execução (mesmo que ainda
+    // em classificação); só as novas vão para o modelo
+    const char *text = row_field(row, ctx->text_col_index);
+    row->key = cache_key(ctx->identity, text, strlen(text));
+    if (cache_lookup(ctx->cache, row->key, &row->label)) {
+        row->source = ROW_CACHED;
+        ctx->cache_hits++;
+    } else if (memo_find(&ctx->memo, row->key) != NULL) {
+        row->source = ROW_REPEAT;
+        ctx->repeat_hits++;
+    } else {
+        row->source = ROW_INFER;
+        memo_insert(&ctx->memo, row->key, CACHE_PENDING);
+        ctx->misses++;
     }
+    if (b->n == ctx->batch_size) dispatch_batch(ctx);
+}
+
+// Envia o último lote (incompleto) e espera todos os lotes em andamento
+void finish_batches(RowContext *ctx) {
+    if (ctx->inflight < ctx->depth) dispatch_batch(ctx);
+    while (ctx->inflight > 0) complete_oldest(ctx);
+}
+
+// Operação coletiva: junta no rank 0 os resultados novos de todos os ranks e
+// grava o cache com eles. Retorna (no rank 0) o total de entradas ou -1.
+long long save_cache(const char *path, const ResultCache *cache, RowContext *ctx, int rank, int nprocs) {
+    int bytes = (int)(ctx->added_count * sizeof(CacheEntry));
+    int *counts = NULL, *displs = NULL;
+    CacheEntry *all = NULL;
+    int total = 0;
+    if (rank == 0) {
+        counts = malloc(sizeof(int) * nprocs);
+        displs = malloc(sizeof(int) * nprocs);
+    }
+    MPI_Gather(&bytes, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        for (int r = 0; r < nprocs; ++r) {
+            displs[r] = total;
+            total += counts[r];
+        }
+        all = malloc(total > 0 ? total : 1);
+    }
+    MPI_Gatherv(ctx->added, bytes, MPI_BYTE, all, counts, displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    long long entries = 0;
+    if (rank == 0) {
+        entries = cache_save(path, cache, all, (size_t)total / sizeof(CacheEntry));
+        free(all);
+        free(counts);
+        free(displs);
+    }
+    return entries;
+}
+
+// Operação coletiva: cada rank grava suas linhas (já serializadas em buf)
+// direto no arquivo final, logo após as dos ranks anteriores (offset calculado
+// com MPI_Exscan), então a saída fica na ordem da entrada. Retorna 0 ou -1 (em
+// todos os ranks).
+int write_output(const char *path, const char *buf, size_t len, int rank) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        return -1;
+    }
+    MPI_File_set_size(fh, 0);   // descarta um arquivo anterior maior
+
+    long long mine = (long long)len, offset = 0;
+    MPI_Exscan(&mine, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) offset = 0;
+
+    // Em rodadas de até 1 GB (a contagem do MPI é int); todos os ranks
+    // participam de todas as rodadas, mesmo sem mais nada a gravar
+    const size_t max_block = (size_t)1 << 30;
+    long long rounds = (long long)((len + max_block - 1) / max_block);
+    MPI_Allreduce(MPI_IN_PLACE, &rounds, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    int ok = 1;
+    size_t done = 0;
+    for (long long r = 0; r < rounds; ++r) {
+        int n = (int)(len - done < max_block ? len - done : max_block);
+        MPI_Status status;
+        if (MPI_File_write_at_all(fh, (MPI_Offset)(offset + (long long)done), buf + done, n, MPI_CHAR, &status) != MPI_SUCCESS) ok = 0;
+        done += (size_t)n;
+    }
+    if (MPI_File_close(&fh) != MPI_SUCCESS) ok = 0;
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return ok ? 0 : -1;
 }
 
 int main(int argc, char **argv) {
     if (argc < 3) {
-        fprintf(stderr, "Uso: %s input.csv output.csv\n", argv[0]);
+        fprintf(stderr, "Uso: %s input.csv output.csv [--batch N] [--depth K] [--cache arquivo] [--progress segundos]\n", argv[0]);
         return 1;
     }
 
     const char *input_csv = argv[1];
     const char *output_csv = argv[2];
 
+    // Músicas por pedido ao classificador (1 = uma consulta ao modelo por música)
+    int batch_size = DEFAULT_BATCH_SIZE;
+    // Lotes em classificação ao mesmo tempo por rank (um coprocesso para cada)
+    int depth = DEFAULT_DEPTH;
+    // Cache de resultados em disco (sem ele, só as letras repetidas na execução são reaproveitadas)
+    const char *cache_path = NULL;
+    // Intervalo entre os resumos globais de progresso (0 = sem resumos)
+    double progress_interval = DEFAULT_PROGRESS_INTERVAL;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);
+            if (batch_size < 1 || batch_size > MAX_BATCH_SIZE) {
+                fprintf(stderr, "Tamanho de lote inválido: %s (use 1 a %d)\n", argv[i], MAX_BATCH_SIZE);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+            if (depth < 1 || depth > MAX_DEPTH) {
+                fprintf(stderr, "Profundidade inválida: %s (use 1 a %d)\n", argv[i], MAX_DEPTH);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else if (strcmp(argv[i], "--progress") == 0 && i + 1 < argc) {
+            progress_interval = atof(argv[++i]);
+            if (progress_interval < 0) {
+                fprintf(stderr, "Intervalo de progresso inválido: %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Opção desconhecida: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
     MPI_Init(&argc, &argv);
     int rank, nprocs;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
-    FILE *fin = NULL;
-    if (rank == 0) {
-        fin = fopen(input_csv, "r");
-        if (!fin) {
-            fprintf(stderr, "Erro ao abrir %s: %s\n", input_csv, strerror(errno));
+    // Corpus binário (tratamento_csv/converter_csv): todos os ranks mapeiam o
+    // arquivo e leem os campos diretamente, sem parsing de CSV
+    int use_corpus = 0;
+    Corpus corpus;
+    if (rank == 0) use_corpus = corpus_is_file(input_csv);
+    MPI_Bcast(&use_corpus, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (use_corpus && corpus_open(&corpus, input_csv, 0) != 0) {
+        fprintf(stderr, "[rank %d] Corpus binário inválido ou ilegível: %s\n", rank, input_csv);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // CSV: índice das músicas construído uma vez, em paralelo, com MPI-IO;
+    // depois cada rank lê apenas o seu bloco de músicas
+    MPI_File fh;
+    RowIndex index = { NULL, 0 };
+    if (!use_corpus) {
+        if (MPI_File_open(MPI_COMM_WORLD, input_csv, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+            if (rank == 0) fprintf(stderr, "Erro ao abrir %s\n", input_csv);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (row_index_build(fh, &index) != 0) {
+            if (rank == 0) fprintf(stderr, "Erro ao ler %s\n", input_csv);
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
     }
 
-    char header[MAXLINE];
     int text_col_index = -1;
     int artist_col_index = -1;
     int song_col_index = -1;
     char **headers = NULL;
     int num_header_fields = 0;
-    long total_rows = 0;
+    long total_rows = use_corpus ? (long)corpus.num_rows : index.count;
 
-    if (rank == 0) {
-        if (!fgets(header, sizeof(header), fin)) {
+    if (rank == 0 && use_corpus) {
+        // Colunas fixas do formato, na ordem do CSV original
+        static const char *corpus_headers[] = { "artist", "song", "link", "text" };
+        headers = malloc(sizeof(char*) * MAXFIELDS);
+        num_header_fields = 4;
+        for (int i = 0; i < num_header_fields; ++i) headers[i] = strdup(corpus_headers[i]);
+        artist_col_index = 0;
+        song_col_index = 1;
+        text_col_index = 3;
+    } else if (rank == 0) {
+        // Cabeçalho: o registro antes da primeira música
+        size_t hlen = (size_t)(index.count > 0 ? index.offsets[0] : index.offsets[index.count]);
+        char *header = malloc(hlen + 1);
+        if (!header || hlen == 0 || row_index_read(fh, 0, (MPI_Offset)hlen, header) != 0) {
             fprintf(stderr, "Arquivo vazio ou erro ao ler cabeçalho.\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        size_t hlen = strlen(header);
-        if (hlen && (header[hlen-1] == '\n' || header[hlen-1] == '\r')) {
-            header[hlen-1] = '\0';
-            hlen--;
-            if (hlen && header[hlen-1] == '\r') { header[hlen-1] = '\0'; hlen--; }
-        }
+        while (hlen && (header[hlen-1] == '\n' || header[hlen-1] == '\r')) hlen--;
+        header[hlen] = '\0';
         headers = malloc(sizeof(char*) * MAXFIELDS);
-        num_header_fields = parse_csv_line(header, headers, MAXFIELDS);
+        num_header_fields = split_csv_line(header, hlen, headers, MAXFIELDS);
+        for (int i = 0; i < num_header_fields; ++i) headers[i] = strdup(headers[i]);
         for (int i = 0; i < num_header_fields; ++i) {
             if (strcasecmp(headers[i], "text") == 0) text_col_index = i;
             if (strcasecmp(headers[i], "artist") == 0) artist_col_index = i;
@@ -119,19 +553,13 @@ int main(int argc, char **argv) {
             fprintf(stderr, "Coluna 'song' não encontrada no cabeçalho.\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        char line[MAXLINE];
-        total_rows = 0;
-        while (fgets(line, sizeof(line), fin)) {
-            total_rows++;
-        }
-        fclose(fin);
+        free(header);
     }
 
     MPI_Bcast(&text_col_index, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&artist_col_index, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&song_col_index, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&num_header_fields, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&total_rows, 1, MPI_LONG, 0, MPI_COMM_WORLD);
 
     if (rank != 0) {
         headers = malloc(sizeof(char*) * MAXFIELDS);
@@ -153,182 +581,153 @@ int main(int argc, char **argv) {
         }
     }
 
-    fin = fopen(input_csv, "r");
-    if (!fin) {
-        fprintf(stderr, "[rank %d] Erro ao abrir %s: %s\n", rank, input_csv, strerror(errno));
-        MPI_Abort(MPI_COMM_WORLD, 1);
-    }
-    char tmpbuf[MAXLINE];
-    if (!fgets(tmpbuf, sizeof(tmpbuf), fin)) {
-        fprintf(stderr, "Erro lendo cabeçalho (segunda vez)\n");
-        MPI_Abort(MPI_COMM_WORLD, 1);
-    }
-
-    char out_tmpname[1024];
-    snprintf(out_tmpname, sizeof(out_tmpname), "%s/sent_part_rank_%d.csv", TMPDIR, rank);
-    FILE *fout = fopen(out_tmpname, "w");
+    // Saída do rank serializada em memória e gravada no final com write_output;
+    // o cabeçalho vai só na parte do rank 0, que é a primeira do arquivo
+    char *out_buf = NULL;
+    size_t out_len = 0;
+    FILE *fout = open_memstream(&out_buf, &out_len);
     if (!fout) {
-        fprintf(stderr, "[rank %d] Erro ao abrir saída %s: %s\n", rank, out_tmpname, strerror(errno));
+        fprintf(stderr, "[rank %d] Erro ao criar buffer de saída: %s\n", rank, strerror(errno));
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    for (int i = 0; i < num_header_fields; ++i) {
-        if (i) fprintf(fout, ",");
-        if (headers[i]) {
-            int need_quote = (strchr(headers[i], ',') != NULL);
-            if (need_quote) fprintf(fout, "\"%s\"", headers[i]);
-            else fprintf(fout, "%s", headers[i]);
+    if (rank == 0) {
+        for (int i = 0; i < num_header_fields; ++i) {
+            if (i) fprintf(fout, ",");
+            if (headers[i]) write_csv_field(fout, headers[i]);
         }
+        fprintf(fout, ",sentimento\n");
     }
-    fprintf(fout, ",sentimento\n");
 
-    long cnt_pos = 0, cnt_neg = 0, cnt_neu = 0, cnt_total = 0;
-
-    long line_index = 0;
-    while (fgets(tmpbuf, sizeof(tmpbuf), fin)) {
-        if ((line_index % nprocs) != rank) {
-            line_index++;
-            continue;
+    // Coprocessos de classificação do rank (canais), usados para todas as músicas
+    Classifier *channels = malloc(sizeof(Classifier) * depth);
+    Batch *slots = calloc(depth, sizeof(Batch));
+    if (!channels || !slots) {
+        fprintf(stderr, "[rank %d] Erro: memória insuficiente\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int c = 0; c < depth; ++c) {
+        if (classifier_start(&channels[c], CLASSIFIER_SCRIPT) != 0) {
+            fprintf(stderr, "[rank %d] Erro ao iniciar python3 %s: %s\n", rank, CLASSIFIER_SCRIPT, strerror(errno));
         }
-
-        char *fields[MAXFIELDS] = {0};
-        int nf = parse_csv_line(tmpbuf, fields, MAXFIELDS);
-        if (nf <= 0) {
-            line_index++;
-            free_fields(fields, nf);
-            continue;
+        slots[c].rows = malloc(sizeof(PendingRow) * batch_size);
+        if (!slots[c].rows) {
+            fprintf(stderr, "[rank %d] Erro: memória insuficiente\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
+    }
 
-        char *text_field = NULL;
-    char *artist_field = (artist_col_index < nf) ? fields[artist_col_index] : "";
-    char *song_field = (song_col_index < nf) ? fields[song_col_index] : "";
-    if (text_col_index < nf) text_field = fields[text_col_index];
-    else text_field = "";
-
-        char tmpfile[1024];
-        snprintf(tmpfile, sizeof(tmpfile), "%s/sent_rank%d_line%ld.txt", TMPDIR, rank, line_index);
-        FILE *tf = fopen(tmpfile, "w");
-        if (!tf) {
-            fprintf(stderr, "[rank %d] Erro escrevendo tmpfile %s\n", rank, tmpfile);
-            tf = fopen(tmpfile, "w");
-            if (!tf) { }
-        }
-        if (tf) {
-            fprintf(tf, "%s\n", text_field ? text_field : "");
-            fclose(tf);
+    // Identidade do classificador (a de qualquer canal que iniciou), parte da chave do cache
+    char identity[CLASSIFIER_MAX_IDENTITY] = "";
+    for (int c = 0; c < depth; ++c) {
+        char channel_identity[CLASSIFIER_MAX_IDENTITY];
+        if (classifier_hello(&channels[c], channel_identity, sizeof(channel_identity)) == 0 && identity[0] == '\0') {
+            strcpy(identity, channel_identity);
         }
+    }
 
-        char cmd[2048];
-        snprintf(cmd, sizeof(cmd), "python3 classify_ollama.py --file \"%s\"", tmpfile);
-
-        FILE *pp = popen(cmd, "r");
-        char sentiment[128] = {0};
-        if (pp) {
-            if (fgets(sentiment, sizeof(sentiment), pp)) {
-                size_t sl = strlen(sentiment);
-                while (sl > 0 && (sentiment[sl-1] == '\n' || sentiment[sl-1] == '\r')) {
-                    sentiment[--sl] = '\0';
-                }
-            } else {
-                strcpy(sentiment, "neutro");
-            }
-            int rc = pclose(pp);
-            (void)rc;
-        } else {
-            strcpy(sentiment, "neutro");
+    ResultCache cache;
+    if (cache_path && cache_open(&cache, cache_path) != 0 && rank == 0) {
+        fprintf(stderr, "Cache %s inválido: será recriado\n", cache_path);
+    }
+    if (!cache_path) memset(&cache, 0, sizeof(cache));
+
+    RowContext ctx = { rank, text_col_index, artist_col_index, song_col_index, channels, slots,
+                       depth, batch_size, 0, 0, identity, &cache };
+    memo_init(&ctx.memo);
+    Progress progress;
+    progress_init(&progress, progress_interval, rank, nprocs);
+    ctx.progress = &progress;
+    ctx.fout = fout;
+
+    // Cada rank fica com um bloco contíguo de músicas
+    long first_row = total_rows * rank / nprocs, last_row = total_rows * (rank + 1) / nprocs;
+
+    if (use_corpus) {
+        // Mesmo bloco contíguo do CSV, com os campos apontando para o mapeamento
+        if (corpus_check_rows(&corpus, (uint64_t)first_row, (uint64_t)last_row) != 0) {
+            fprintf(stderr, "[rank %d] Corpus binário inconsistente nas músicas %ld a %ld\n", rank, first_row, last_row);
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-
-        printf("[rank %d] Artista: %s | Música: %s | Sentimento: %s\n", rank, artist_field, song_field, sentiment);
-
-        if (strcmp(sentiment, "positivo") == 0) cnt_pos++;
-        else if (strcmp(sentiment, "negativo") == 0) cnt_neg++;
-        else cnt_neu++;
-
-        for (int i = 0; i < nf; ++i) {
-            if (i) fprintf(fout, ",");
-            if (fields[i]) {
-                int need_quote = (strchr(fields[i], ',') != NULL || strchr(fields[i], '"') != NULL);
-                if (need_quote) {
-                    fprintf(fout, "\"");
-                    for (char *c = fields[i]; *c; ++c) {
-                        if (*c == '"') fprintf(fout, "\"\"");
-                        else fputc(*c, fout);
-                    }
-                    fprintf(fout, "\"");
-                } else {
-                    fprintf(fout, "%s", fields[i]);
-                }
-            }
+        for (uint64_t row = (uint64_t)first_row; row < (uint64_t)last_row; row++) {
+            char *fields[CORPUS_COLUMNS];
+            for (int c = 0; c < CORPUS_COLUMNS; ++c) fields[c] = corpus_field(&corpus, (CorpusColumn)c, row, NULL);
+            queue_row(fields, CORPUS_COLUMNS, (long)row, &ctx);
         }
-        fprintf(fout, ",%s\n", sentiment);
-
-        free_fields(fields, nf);
-
-        remove(tmpfile);
-
-        cnt_total++;
-        if (cnt_total % 2 == 0) {
-            long sum_pos = 0, sum_neg = 0, sum_neu = 0, sum_total = 0;
-            MPI_Reduce(&cnt_pos, &sum_pos, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-            MPI_Reduce(&cnt_neg, &sum_neg, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-            MPI_Reduce(&cnt_neu, &sum_neu, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-            MPI_Reduce(&cnt_total, &sum_total, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-            if (rank == 0) {
-                printf("\n[global] Resumo após %ld músicas: Positivo = %ld, Negativo = %ld, Neutro = %ld\n\n",
-                       sum_total, sum_pos, sum_neg, sum_neu);
-            }
+        finish_batches(&ctx);
+        corpus_close(&corpus);
+    } else {
+        // Uma única leitura com todas as músicas do bloco deste rank
+        MPI_Offset begin = index.offsets[first_row], end = index.offsets[last_row];
+        char *block = malloc((size_t)(end - begin) + 1);
+        if (!block || row_index_read(fh, begin, end, block) != 0) {
+            fprintf(stderr, "[rank %d] Erro lendo %s\n", rank, input_csv);
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        line_index++;
+        for (long row = first_row; row < last_row; row++) {
+            char *line = block + (index.offsets[row] - begin);
+            size_t len = (size_t)(index.offsets[row + 1] - index.offsets[row]);
+            while (len && (line[len-1] == '\n' || line[len-1] == '\r')) len--;
+            if (len == 0) continue;   // linha em branco
+
+            // Os campos apontam para o bloco, que só é liberado após o último lote
+            char *fields[MAXFIELDS];
+            int nf = split_csv_line(line, len, fields, MAXFIELDS);
+            queue_row(fields, nf, row, &ctx);
+        }
+        finish_batches(&ctx);
+        free(block);
+    }
+    if (fclose(fout) != 0) {
+        fprintf(stderr, "[rank %d] Erro: memória insuficiente para a saída\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // Antes da primeira operação coletiva (MPI_File_close): o rank 0 continua
+    // imprimindo o progresso enquanto os outros ranks terminam
+    long final_counts[PROGRESS_FIELDS] = { ctx.cnt_pos, ctx.cnt_neg, ctx.cnt_neu, ctx.cnt_total };
+    progress_finish(&progress, rank, final_counts);
+    progress_free(&progress);
+    if (!use_corpus) {
+        row_index_free(&index);
+        MPI_File_close(&fh);
     }
+    for (int c = 0; c < depth; ++c) {
+        classifier_stop(&channels[c]);
+        free(slots[c].rows);
+    }
+    free(channels);
+    free(slots);
+    memo_free(&ctx.memo);
 
-    fclose(fin);
-    fclose(fout);
+    long long cache_entries = cache_path ? save_cache(cache_path, &cache, &ctx, rank, nprocs) : 0;
+    cache_close(&cache);
+    free(ctx.added);
+    long cache_stats[3] = { ctx.cache_hits, ctx.repeat_hits, ctx.misses }, total_cache[3] = { 0, 0, 0 };
+    MPI_Reduce(cache_stats, total_cache, 3, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
 
     long total_pos = 0, total_neg = 0, total_neu = 0, total_all = 0;
-    MPI_Reduce(&cnt_pos, &total_pos, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&cnt_neg, &total_neg, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&cnt_neu, &total_neu, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&cnt_total, &total_all, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&ctx.cnt_pos, &total_pos, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&ctx.cnt_neg, &total_neg, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&ctx.cnt_neu, &total_neu, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&ctx.cnt_total, &total_all, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    if (write_output(output_csv, out_buf, out_len, rank) != 0) {
+        if (rank == 0) fprintf(stderr, "Erro ao gravar %s\n", output_csv);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    free(out_buf);
 
     if (rank == 0) {
-        FILE *fout_final = fopen(output_csv, "w");
-        if (!fout_final) {
-            fprintf(stderr, "Erro ao criar %s: %s\n", output_csv, strerror(errno));
-            MPI_Abort(MPI_COMM_WORLD, 1);
-        }
-        char headerline[MAXLINE];
-        char partname[1024];
-        snprintf(partname, sizeof(partname), "%s/sent_part_rank_%d.csv", TMPDIR, 0);
-        FILE *p0 = fopen(partname, "r");
-        if (!p0) {
-            fprintf(stderr, "Erro ao abrir parte %s\n", partname);
-            MPI_Abort(MPI_COMM_WORLD, 1);
-        }
-        if (!fgets(headerline, sizeof(headerline), p0)) {
-            fprintf(stderr, "Erro ler header da parte %s\n", partname);
-            MPI_Abort(MPI_COMM_WORLD, 1);
-        }
-        fputs(headerline, fout_final);
-        while (fgets(headerline, sizeof(headerline), p0)) fputs(headerline, fout_final);
-        fclose(p0);
-
-        for (int r = 1; r < nprocs; ++r) {
-            snprintf(partname, sizeof(partname), "%s/sent_part_rank_%d.csv", TMPDIR, r);
-            FILE *pr = fopen(partname, "r");
-            if (!pr) continue;
-            if (!fgets(headerline, sizeof(headerline), pr)) { fclose(pr); continue; }
-            while (fgets(headerline, sizeof(headerline), pr)) fputs(headerline, fout_final);
-            fclose(pr);
-            remove(partname);
-        }
-        fclose(fout_final);
-
         printf("Total linhas processadas: %ld\n", total_all);
         printf("Positivo: %ld (%.2f%%)\n", total_pos, total_all ? (100.0 * total_pos / total_all) : 0.0);
         printf("Negativo: %ld (%.2f%%)\n", total_neg, total_all ? (100.0 * total_neg / total_all) : 0.0);
         printf("Neutro:   %ld (%.2f%%)\n", total_neu, total_all ? (100.0 * total_neu / total_all) : 0.0);
+        long lookups = total_cache[0] + total_cache[1] + total_cache[2];
+        printf("Cache: %ld acertos (%ld do arquivo, %ld letras repetidas), %ld faltas classificadas pelo modelo (acertos: %.2f%%)\n",
+               total_cache[0] + total_cache[1], total_cache[0], total_cache[1], total_cache[2],
+               lookups ? 100.0 * (total_cache[0] + total_cache[1]) / lookups : 0.0);
+        if (cache_path && cache_entries >= 0) printf("Cache salvo em %s (%lld entradas)\n", cache_path, cache_entries);
+        else if (cache_path) fprintf(stderr, "Erro ao gravar o cache %s\n", cache_path);
         printf("Arquivo final escrito: %s\n", output_csv);
     }
 
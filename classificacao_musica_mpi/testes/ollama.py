@@ -0,0 +1,27 @@
+"""Substituto do módulo ollama para os testes do sentiment_mpi (verificar.sh).
+
+Responde de forma determinística (o sentimento vem do CRC32 da letra), sem
+servidor. Com FAKE_OLLAMA_FALHA=1, toda consulta falha como um Ollama fora do ar.
+"""
+
+import os
+import re
+import zlib
+
+SENTIMENTOS = ['positivo', 'negativo', 'neutro']
+
+
+def sentimento(letra):
+    return SENTIMENTOS[zlib.crc32(letra.strip().encode('utf-8')) % 3]
+
+
+def chat(model, messages):
+    if os.environ.get('FAKE_OLLAMA_FALHA'):
+        raise ConnectionError('Ollama indisponível (teste)')
+    pedido = messages[-1]['content']
+    if 'numeradas' in messages[0]['content']:
+        letras = re.findall(r'Letra \d+:\n"""\n(.*?)\n"""', pedido, re.S)
+        linhas = [f'{i}: {sentimento(letra)}' for i, letra in enumerate(letras, 1)]
+        return {'message': {'content': '\n'.join(linhas)}}
+    letra = pedido.split('\n\n"""\n', 1)[1].rsplit('\n"""', 1)[0]
+    return {'message': {'content': sentimento(letra)}}
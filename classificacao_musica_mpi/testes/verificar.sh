@@ -0,0 +1,64 @@
+#!/bin/bash
+# Testes do sentiment_mpi com um Ollama simulado (testes/ollama.py), sem servidor.
+# Uso (no diretório classificacao_musica_mpi): make check
+# MPIRUN pode trocar o lançador, por exemplo MPIRUN="mpirun --oversubscribe".
+
+cd "$(dirname "$0")/.." || exit 1
+MPIRUN=${MPIRUN:-mpirun}
+NP=${NP:-2}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+export PYTHONPATH="$PWD/testes${PYTHONPATH:+:$PYTHONPATH}"
+
+falhas=0
+ok() { echo "ok: $1"; }
+falha() { echo "FALHOU: $1"; falhas=$((falhas + 1)); }
+
+# Registros CSV (um campo entre aspas pode ter quebras de linha)
+registros() {
+    python3 -c 'import csv, sys; print(sum(1 for _ in csv.reader(open(sys.argv[1], newline=""))))' "$1"
+}
+
+# Entrada com letras de várias linhas, aspas escapadas e vírgulas
+python3 - "$TMP/entrada.csv" <<'PY'
+import csv, sys
+with open(sys.argv[1], 'w', newline='') as f:
+    w = csv.writer(f)
+    w.writerow(['artist', 'song', 'link', 'text'])
+    for i in range(30):
+        if i % 2:
+            letra = f'verso {i}\nrefrão "{i % 7}", de novo\r\nfim {i % 5}'
+        else:
+            letra = f'verso {i}\nsó quebras de linha\r\nfim {i % 5}'
+        w.writerow([f'Artista {i % 4}', f'Música {i}', f'/a/{i}', letra])
+PY
+
+# 1. Ollama fora do ar: as músicas saem neutras e nada vai para o cache
+FAKE_OLLAMA_FALHA=1 $MPIRUN -np "$NP" ./sentiment_mpi "$TMP/entrada.csv" "$TMP/falha.csv" \
+    --cache "$TMP/cache.bin" --progress 0 > "$TMP/falha.log" 2>&1
+if grep -q "Cache salvo em .* (0 entradas)" "$TMP/falha.log"; then
+    ok "falhas do classificador não vão para o cache"
+else
+    falha "falhas do classificador não vão para o cache"
+    grep "Cache" "$TMP/falha.log"
+fi
+
+# 2. Com o Ollama de volta, as letras são classificadas (não vêm do cache)
+$MPIRUN -np "$NP" ./sentiment_mpi "$TMP/entrada.csv" "$TMP/saida.csv" \
+    --cache "$TMP/cache.bin" --progress 0 > "$TMP/saida.log" 2>&1
+if grep -q "Cache: 0 acertos" "$TMP/saida.log"; then
+    ok "reexecução classifica as letras que falharam"
+else
+    falha "reexecução classifica as letras que falharam"
+    grep "Cache" "$TMP/saida.log"
+fi
+
+# 3. Ida e volta: a saída tem os mesmos registros da entrada
+if [ "$(registros "$TMP/entrada.csv")" = "$(registros "$TMP/saida.csv")" ]; then
+    ok "saída com o mesmo número de registros da entrada"
+else
+    falha "saída com o mesmo número de registros da entrada ($(registros "$TMP/entrada.csv") != $(registros "$TMP/saida.csv"))"
+fi
+
+[ "$falhas" -eq 0 ] && echo "Todos os testes passaram" || echo "$falhas teste(s) falharam"
+exit "$falhas"
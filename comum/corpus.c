@@ -0,0 +1,119 @@
+#include "corpus.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int corpus_is_file(const char *path) {
+    char magic[8];
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return 0;
+    int ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, CORPUS_MAGIC, 8) == 0;
+    fclose(f);
+    return ok;
+}
+
+// A seção [offset, offset + count * elem) cabe no arquivo?
+static int section_fits(size_t file_size, uint64_t offset, uint64_t count, uint64_t elem) {
+    if (offset > file_size || offset % 8 != 0) return 0;
+    return count <= (file_size - offset) / elem;
+}
+
+// Só o cabeçalho, as seções e os extremos de cada vetor de offsets: não lê os
+// dados por linha, para que cada rank só traga para a memória as páginas das
+// suas músicas (as linhas são verificadas em corpus_check_rows)
+static int corpus_validate(Corpus *c) {
+    const CorpusHeader *h;
+    if (c->size < sizeof(CorpusHeader)) return -1;
+    h = c->header = (const CorpusHeader *)c->base;
+    if (memcmp(h->magic, CORPUS_MAGIC, 8) != 0 || h->version != CORPUS_VERSION ||
+        h->header_size != sizeof(CorpusHeader) || h->file_size != c->size) return -1;
+    if (h->num_rows >= UINT32_MAX || h->num_artists >= UINT32_MAX) return -1;
+
+    if (!section_fits(c->size, h->artist_ids, h->num_rows, sizeof(uint32_t))) return -1;
+    c->artist_ids = (const uint32_t *)(c->base + h->artist_ids);
+    c->num_rows = h->num_rows;
+
+    for (int col = 0; col < CORPUS_COLUMNS; col++) {
+        uint64_t n = col == CORPUS_ARTIST ? h->num_artists : h->num_rows;
+        if (!section_fits(c->size, h->offsets[col], n + 1, sizeof(uint64_t)) ||
+            !section_fits(c->size, h->blobs[col], h->blob_sizes[col], 1)) return -1;
+        c->offsets[col] = (const uint64_t *)(c->base + h->offsets[col]);
+        c->blobs[col] = (char *)(c->base + h->blobs[col]);
+
+        // O blob começa no primeiro offset e termina no último, com um '\0'
+        const uint64_t *off = c->offsets[col];
+        if (off[0] != 0 || off[n] != h->blob_sizes[col]) return -1;
+        if (n > 0 && (h->blob_sizes[col] == 0 || c->blobs[col][h->blob_sizes[col] - 1] != '\0')) return -1;
+    }
+    return 0;
+}
+
+// A string i da coluna col tem offsets crescentes, dentro do blob, e termina em '\0'?
+static int string_ok(const Corpus *c, int col, uint64_t i) {
+    const uint64_t *off = c->offsets[col];
+    return off[i] < off[i + 1] && off[i + 1] <= c->header->blob_sizes[col] &&
+           c->blobs[col][off[i + 1] - 1] == '\0';
+}
+
+int corpus_check_rows(const Corpus *corpus, uint64_t begin, uint64_t end) {
+    if (begin > end || end > corpus->num_rows) return -1;
+    for (uint64_t row = begin; row < end; row++) {
+        if (corpus->artist_ids[row] >= corpus->header->num_artists ||
+            !string_ok(corpus, CORPUS_ARTIST, corpus->artist_ids[row])) return -1;
+        for (int col = CORPUS_SONG; col < CORPUS_COLUMNS; col++) {
+            if (!string_ok(corpus, col, row)) return -1;
+        }
+    }
+    return 0;
+}
+
+int corpus_open(Corpus *corpus, const char *path, int writable) {
+    memset(corpus, 0, sizeof(*corpus));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *base = mmap(NULL, (size_t)st.st_size, prot, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    corpus->base = base;
+    corpus->size = (size_t)st.st_size;
+    if (corpus_validate(corpus) < 0) {
+        corpus_close(corpus);
+        return -1;
+    }
+    return 0;
+}
+
+void corpus_close(Corpus *corpus) {
+    if (corpus->base != NULL) munmap(corpus->base, corpus->size);
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+// Primeira linha em [first, last] cujo texto começa em target ou depois
+static uint64_t row_at_text_offset(const Corpus *corpus, uint64_t first, uint64_t last, uint64_t target) {
+    const uint64_t *off = corpus->offsets[CORPUS_TEXT];
+    while (first < last) {
+        uint64_t mid = first + (last - first) / 2;
+        if (off[mid] < target) first = mid + 1;
+        else last = mid;
+    }
+    return first;
+}
+
+void corpus_split(const Corpus *corpus, uint64_t first, uint64_t last, int part, int nparts,
+                  uint64_t *begin, uint64_t *end) {
+    const uint64_t *off = corpus->offsets[CORPUS_TEXT];
+    uint64_t bytes = off[last] - off[first];
+    *begin = row_at_text_offset(corpus, first, last, off[first] + bytes * (uint64_t)part / nparts);
+    *end = row_at_text_offset(corpus, first, last, off[first] + bytes * (uint64_t)(part + 1) / nparts);
+}
@@ -0,0 +1,85 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Formato binário colunar do corpus de letras, gerado por
+// tratamento_csv/converter_csv a partir do CSV original e lido com mmap pelos
+// programas MPI (sem nenhum parsing de CSV em tempo de execução).
+//
+// Layout (inteiros little-endian, seções alinhadas em 8 bytes):
+//   CorpusHeader
+//   artist_ids: uint32[num_rows]         (índice no dicionário de artistas)
+//   para cada coluna c (artista, música, link, letra):
+//     offsets[c]: uint64[n + 1]          (n = num_artists para o artista,
+//                                         num_rows para as demais)
+//     blob[c]:    strings concatenadas; a string i ocupa
+//                 [offsets[i], offsets[i + 1]) e termina com '\0' (incluído)
+// As letras já vêm normalizadas (quebras de linha e espaços repetidos viram um
+// único espaço), como fazia o antigo tratar_csv.py.
+
+#define CORPUS_MAGIC "SPCORP01"
+#define CORPUS_VERSION 1
+
+typedef enum {
+    CORPUS_ARTIST,   // dicionário: um registro por artista distinto
+    CORPUS_SONG,
+    CORPUS_LINK,
+    CORPUS_TEXT,
+    CORPUS_COLUMNS
+} CorpusColumn;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t num_rows;
+    uint64_t num_artists;
+    uint64_t artist_ids;                  // deslocamento da seção artist_ids
+    uint64_t offsets[CORPUS_COLUMNS];     // deslocamento de cada vetor de offsets
+    uint64_t blobs[CORPUS_COLUMNS];       // deslocamento de cada blob
+    uint64_t blob_sizes[CORPUS_COLUMNS];
+    uint64_t file_size;
+} CorpusHeader;
+
+// Corpus mapeado em memória
+typedef struct {
+    unsigned char *base;
+    size_t size;
+    const CorpusHeader *header;
+    const uint32_t *artist_ids;
+    const uint64_t *offsets[CORPUS_COLUMNS];
+    char *blobs[CORPUS_COLUMNS];
+    uint64_t num_rows;
+} Corpus;
+
+// 1 se o arquivo começa com CORPUS_MAGIC, 0 caso contrário
+int corpus_is_file(const char *path);
+
+// Mapeia o arquivo e valida o cabeçalho e as seções (sem percorrer as
+// linhas). Com writable, o mapeamento é privado e gravável (cópia sob demanda),
+// para quem transforma as letras no lugar. Retorna 0 ou -1 (arquivo
+// inexistente, truncado ou inconsistente).
+int corpus_open(Corpus *corpus, const char *path, int writable);
+void corpus_close(Corpus *corpus);
+
+// Valida as linhas [begin, end) (artista existente, offsets crescentes e
+// strings terminadas em '\0'); cada rank verifica só as suas, antes de usar
+// corpus_field nelas. Retorna 0 ou -1.
+int corpus_check_rows(const Corpus *corpus, uint64_t begin, uint64_t end);
+
+// Campo col da linha row, terminado em '\0'; *len recebe o tamanho sem o '\0'
+static inline char *corpus_field(const Corpus *corpus, CorpusColumn col, uint64_t row, size_t *len) {
+    uint64_t i = col == CORPUS_ARTIST ? corpus->artist_ids[row] : row;
+    const uint64_t *off = corpus->offsets[col];
+    if (len) *len = (size_t)(off[i + 1] - off[i] - 1);
+    return corpus->blobs[col] + off[i];
+}
+
+// Divide as linhas [first, last) em nparts faixas contíguas com quantidades
+// de texto (bytes de letra) parecidas; [*begin, *end) é a faixa part
+void corpus_split(const Corpus *corpus, uint64_t first, uint64_t last, int part, int nparts,
+                  uint64_t *begin, uint64_t *end);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <stddef.h>
+#include <string.h>
+
+// Separação de registros CSV (RFC 4180) em campos sem cópia nem alocação: cada
+// campo é uma visão (ponteiro + tamanho) para o próprio registro. Um campo
+// entre aspas simples (sem "" dentro) já vem sem as aspas; os demais campos
+// entre aspas ficam marcados como escaped e só são desfeitos quando o chamador
+// precisa do texto (csv_field_unescape), no próprio buffer.
+//
+// O registro não precisa terminar em '\0' e não deve incluir o terminador de
+// linha. Conteúdo após a aspa de fechamento (malformado) é mantido, como no
+// tratamento_csv/converter_csv; uma vírgula final gera um último campo vazio.
+
+typedef struct {
+    char *ptr;
+    size_t len;
+    int escaped;    // campo bruto, a partir da aspa de abertura, ainda com ""
+} CsvField;
+
+// Separa record[0..len) em até maxfields campos; retorna quantos foram separados
+static inline int csv_split(char *record, size_t len, CsvField *fields, int maxfields) {
+    char *p = record, *end = record + len;
+    int n = 0;
+    while (n < maxfields) {
+        CsvField *f = &fields[n++];
+        f->ptr = p;
+        f->escaped = 0;
+        if (p < end && *p == '"') {
+            // Aspa de fechamento: a primeira aspa não seguida de outra
+            char *q = p + 1;
+            for (;;) {
+                q = memchr(q, '"', (size_t)(end - q));
+                if (q == NULL || q + 1 == end || q[1] != '"') break;
+                f->escaped = 1;
+                q += 2;
+            }
+            char *comma = q ? memchr(q, ',', (size_t)(end - q)) : NULL;
+            char *stop = comma ? comma : end;
+            if (q != NULL && !f->escaped && q + 1 == stop) {
+                f->ptr = p + 1;
+                f->len = (size_t)(q - p - 1);
+            } else {
+                f->escaped = 1;
+                f->len = (size_t)(stop - p);
+            }
+            p = stop;
+        } else {
+            char *comma = memchr(p, ',', (size_t)(end - p));
+            char *stop = comma ? comma : end;
+            f->len = (size_t)(stop - p);
+            p = stop;
+        }
+        if (p == end) break;
+        p++;   // vírgula
+    }
+    return n;
+}
+
+// Texto do campo: desfaz as aspas no lugar (o texto só encolhe) e atualiza
+// f->ptr e f->len. O byte f->ptr[f->len] fica dentro do campo bruto ou é a
+// vírgula/fim do registro, então pode receber um '\0' depois de csv_split.
+static inline char *csv_field_unescape(CsvField *f) {
+    if (!f->escaped) return f->ptr;
+    const char *s = f->ptr, *end = f->ptr + f->len;
+    char *out = f->ptr;
+    int in_quotes = 0;
+    for (; s < end; s++) {
+        if (*s != '"') {
+            *out++ = *s;
+        } else if (in_quotes && s + 1 < end && s[1] == '"') {
+            *out++ = '"';
+            s++;
+        } else {
+            in_quotes ^= 1;
+        }
+    }
+    f->len = (size_t)(out - f->ptr);
+    f->escaped = 0;
+    return f->ptr;
+}
+
+#endif
@@ -2,184 +2,449 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "tokenizer.h"
+#include "wire.h"
+#include "sketch.h"
+#include "stats.h"
+#include "corpus.h"
+#include "csv.h"
+#include "snapshot.h"
 
 #define MAX_WORD_LEN 100
 #define MAX_ARTIST_LEN 200
-#define MAX_LINE_LEN 20000
 #define TOP_N 20
 #define INITIAL_CAPACITY 10000
+#define DEFAULT_BLOCK_SIZE (16 * 1024 * 1024)
+#define MIN_BLOCK_SIZE (4 * 1024)
+#define MAX_BLOCK_SIZE (1024 * 1024 * 1024)
+#define DEFAULT_APPROX_SIZE 8192
+#define DEFAULT_DYNAMIC_BLOCK_SIZE (2 * 1024 * 1024)
+
+// Hash FNV-1a de 32 bits: barato e com boa dispersão para chaves curtas
+static inline unsigned int hash_string(const char *s, size_t len) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
 
-// Estrutura para armazenar a contagem de palavras
+// Índice de endereçamento aberto (sondagem linear) sobre um vetor de entradas.
+// Cada slot guarda o índice da entrada (-1 = vazio) e o hash completo, para
+// evitar strcmp na maioria das colisões.
 typedef struct {
-    char word[MAX_WORD_LEN];
+    int idx;
+    unsigned int hash;
+} HashSlot;
+
+typedef struct {
+    HashSlot *slots;
+    size_t mask;
+} HashIndex;
+
+static void *xrealloc(void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (p == NULL && size > 0) {
+        fprintf(stderr, "Erro: memória insuficiente (%zu bytes)\n", size);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return p;
+}
+
+// O índice tem sempre o dobro de slots da capacidade do vetor (fator de carga <= 0.5)
+static void hash_index_init(HashIndex *index, int capacity) {
+    size_t nslots = 16;
+    while (nslots < (size_t)capacity * 2) nslots <<= 1;
+    index->slots = xrealloc(NULL, nslots * sizeof(HashSlot));
+    for (size_t i = 0; i < nslots; i++) index->slots[i].idx = -1;
+    index->mask = nslots - 1;
+}
+
+// Reconstrói o índice com mais slots reaproveitando os hashes já calculados
+static void hash_index_grow(HashIndex *index, int capacity) {
+    HashIndex old = *index;
+    hash_index_init(index, capacity);
+    for (size_t i = 0; i <= old.mask; i++) {
+        if (old.slots[i].idx < 0) continue;
+        size_t pos = old.slots[i].hash & index->mask;
+        while (index->slots[pos].idx >= 0) pos = (pos + 1) & index->mask;
+        index->slots[pos] = old.slots[i];
+    }
+    free(old.slots);
+}
+
+// Cresce o vetor de entradas: dobra até 1M entradas e depois cresce 50% por vez,
+// limitando o desperdício de memória em vocabulários muito grandes
+static int next_capacity(int capacity) {
+    return (capacity < (1 << 20)) ? capacity * 2 : capacity + capacity / 2;
+}
+
+// Arena de strings: cada chave é guardada uma única vez, terminada em '\0', em
+// um bloco contíguo; as tabelas a referenciam pelo deslocamento de 32 bits.
+// Crescer a arena copia apenas os bytes das chaves, e não entradas de
+// tamanho fixo como antes (100 bytes por palavra, 200 por artista).
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} StringArena;
+
+#define ARENA_INITIAL_SIZE (64 * 1024)
+#define ARENA_MAX_SIZE ((size_t)UINT32_MAX)
+
+static uint32_t arena_intern(StringArena *arena, const char *s, size_t len) {
+    if (arena->size + len + 1 > arena->capacity) {
+        if (arena->size + len + 1 > ARENA_MAX_SIZE) {
+            fprintf(stderr, "Erro: arena de chaves excedeu %zu bytes\n", ARENA_MAX_SIZE);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        size_t capacity = arena->capacity ? arena->capacity : ARENA_INITIAL_SIZE;
+        while (capacity < arena->size + len + 1) capacity *= 2;
+        if (capacity > ARENA_MAX_SIZE) capacity = ARENA_MAX_SIZE;
+        arena->data = xrealloc(arena->data, capacity);
+        arena->capacity = capacity;
+    }
+    uint32_t offset = (uint32_t)arena->size;
+    memcpy(arena->data + offset, s, len);
+    arena->data[offset + len] = '\0';
+    arena->size += len + 1;
+    return offset;
+}
+
+// Entrada das tabelas: chave (deslocamento na arena) + contagem, 8 bytes
+typedef struct {
+    uint32_t key;
     int count;
-} WordCount;
+} KeyCount;
 
-// Estrutura para armazenar a contagem de músicas por artista
+// Tabela de contagem: vetor de entradas + índice hash + arena das chaves
 typedef struct {
-    char artist[MAX_ARTIST_LEN];
+    KeyCount *items;
     int count;
-} ArtistCount;
+    int capacity;
+    HashIndex index;
+    StringArena arena;
+} CountTable;
+
+// Palavras e artistas usam a mesma estrutura; os nomes indicam o conteúdo
+typedef CountTable WordTable;
+typedef CountTable ArtistTable;
 
-// Funções de comparação para o qsort
-int compare_word_count(const void *a, const void *b) {
-    return ((WordCount *)b)->count - ((WordCount *)a)->count;
+// Chave da entrada i, terminada em '\0'
+static inline const char *table_key(const CountTable *table, int i) {
+    return table->arena.data + table->items[i].key;
 }
 
-int compare_artist_count(const void *a, const void *b) {
-    return ((ArtistCount *)b)->count - ((ArtistCount *)a)->count;
+void count_table_init(CountTable *table) {
+    table->capacity = INITIAL_CAPACITY;
+    table->count = 0;
+    table->items = xrealloc(NULL, table->capacity * sizeof(KeyCount));
+    hash_index_init(&table->index, table->capacity);
+    table->arena.data = NULL;
+    table->arena.size = table->arena.capacity = 0;
 }
 
-// Função para extrair campos de CSV
-char* extract_csv_field(char **ptr) {
-    if (*ptr == NULL || **ptr == '\0') return NULL;
-    
-    char *start = *ptr;
-    char *field_start = start;
-    
-    // Se o campo começa com aspas
-    if (*start == '"') {
-        field_start = ++start;
-        
-        while (*start) {
-            if (*start == '"') {
-                if (*(start + 1) == '"') {
-                    start += 2;
-                } else {
-                    *start = '\0';
-                    start++;
-                    if (*start == ',') start++;
-                    *ptr = start;
-                    return field_start;
-                }
-            } else {
-                start++;
+void count_table_free(CountTable *table) {
+    free(table->items);
+    free(table->index.slots);
+    free(table->arena.data);
+    table->items = NULL;
+    table->index.slots = NULL;
+    table->arena.data = NULL;
+    table->arena.size = table->arena.capacity = 0;
+    table->count = table->capacity = 0;
+}
+
+// Adiciona count à chave (key não precisa terminar em '\0'), criando-a se preciso
+void count_table_add(CountTable *table, const char *key, size_t len, int count) {
+    unsigned int h = hash_string(key, len);
+    size_t pos = h & table->index.mask;
+    HashSlot *slot;
+    while ((slot = &table->index.slots[pos])->idx >= 0) {
+        const char *existing = table_key(table, slot->idx);
+        if (slot->hash == h && memcmp(existing, key, len) == 0 && existing[len] == '\0') {
+            table->items[slot->idx].count += count;
+            return;
+        }
+        pos = (pos + 1) & table->index.mask;
+    }
+
+    // Nova chave
+    if (table->count >= table->capacity) {
+        table->capacity = next_capacity(table->capacity);
+        table->items = xrealloc(table->items, table->capacity * sizeof(KeyCount));
+        hash_index_grow(&table->index, table->capacity);
+        pos = h & table->index.mask;
+        while (table->index.slots[pos].idx >= 0) pos = (pos + 1) & table->index.mask;
+        slot = &table->index.slots[pos];
+    }
+    table->items[table->count].key = arena_intern(&table->arena, key, len);
+    table->items[table->count].count = count;
+    slot->idx = table->count;
+    slot->hash = h;
+    table->count++;
+}
+
+// Índice da chave na tabela, ou -1 se ela não existe
+int count_table_find(const CountTable *table, const char *key, size_t len) {
+    unsigned int h = hash_string(key, len);
+    size_t pos = h & table->index.mask;
+    const HashSlot *slot;
+    while ((slot = &table->index.slots[pos])->idx >= 0) {
+        const char *existing = table_key(table, slot->idx);
+        if (slot->hash == h && memcmp(existing, key, len) == 0 && existing[len] == '\0') return slot->idx;
+        pos = (pos + 1) & table->index.mask;
+    }
+    return -1;
+}
+
+// Palavras com menos de 2 ou com MAX_WORD_LEN ou mais caracteres são descartadas
+void add_word(WordTable *table, const char *word, size_t len, int count) {
+    if (len < 2 || len >= MAX_WORD_LEN) return;
+    count_table_add(table, word, len, count);
+}
+
+// Artistas vazios ou com MAX_ARTIST_LEN ou mais caracteres são descartados
+void add_artist(ArtistTable *table, const char *artist, size_t len, int count) {
+    if (len == 0 || len >= MAX_ARTIST_LEN) return;
+    count_table_add(table, artist, len, count);
+}
+
+// Comparação de entradas: contagem decrescente e, em caso de empate, ordem
+// alfabética, para que o top-N não dependa da ordem de chegada. As contagens
+// são comparadas sem subtração, que poderia estourar o int.
+static int compare_entries(const CountTable *table, int a, int b) {
+    int ca = table->items[a].count, cb = table->items[b].count;
+    if (ca != cb) return (cb > ca) - (cb < ca);
+    return strcmp(table_key(table, a), table_key(table, b));
+}
+
+// Seleciona as k melhores entradas sem ordenar o vetor inteiro: um min-heap
+// limitado a k índices guarda na raiz o pior dos selecionados, então o custo
+// é O(n log k). Os índices são escritos em out do melhor para o pior; retorna
+// quantos foram selecionados (min(n, k)).
+int select_top_k(const CountTable *table, int k, int *out) {
+    int heap_size = 0;
+    if (k <= 0) return 0;
+
+    for (int i = 0; i < table->count; i++) {
+        int pos;
+        if (heap_size < k) {
+            // Sobe o novo índice enquanto ele for pior que o pai
+            pos = heap_size++;
+            while (pos > 0) {
+                int parent = (pos - 1) / 2;
+                if (compare_entries(table, i, out[parent]) <= 0) break;
+                out[pos] = out[parent];
+                pos = parent;
             }
+            out[pos] = i;
+            continue;
         }
-    } else {
-        // Campo sem aspas
-        while (*start && *start != ',') {
-            start++;
+        // Substitui a raiz (o pior) só se o item for melhor que ela
+        if (compare_entries(table, i, out[0]) >= 0) continue;
+        pos = 0;
+        for (;;) {
+            int child = 2 * pos + 1;
+            if (child >= heap_size) break;
+            if (child + 1 < heap_size && compare_entries(table, out[child + 1], out[child]) > 0) child++;
+            if (compare_entries(table, out[child], i) <= 0) break;
+            out[pos] = out[child];
+            pos = child;
         }
-        if (*start == ',') {
-            *start = '\0';
-            *ptr = start + 1;
-        } else {
-            *ptr = start;
+        out[pos] = i;
+    }
+
+    // Ordena os selecionados retirando a raiz (o pior) para o fim
+    for (int end = heap_size - 1; end > 0; end--) {
+        int worst = out[0];
+        int last = out[end];
+        int pos = 0;
+        for (;;) {
+            int child = 2 * pos + 1;
+            if (child >= end) break;
+            if (child + 1 < end && compare_entries(table, out[child + 1], out[child]) > 0) child++;
+            if (compare_entries(table, out[child], last) <= 0) break;
+            out[pos] = out[child];
+            pos = child;
         }
-        return field_start;
+        out[pos] = last;
+        out[end] = worst;
     }
-    
-    *ptr = start;
-    return field_start;
+    return heap_size;
 }
 
-// Função para adicionar ou incrementar palavra
-void add_word(WordCount **words, int *word_count, int *word_capacity, const char *word) {
-    if (strlen(word) < 2 || strlen(word) >= MAX_WORD_LEN) return;
-    
-    // Procura se a palavra já existe
-    for (int i = 0; i < *word_count; i++) {
-        if (strcmp((*words)[i].word, word) == 0) {
-            (*words)[i].count++;
-            return;
-        }
+// Resumos do modo aproximado (--approx): memória fixa, independente do vocabulário
+typedef struct {
+    SpaceSaving words;
+    SpaceSaving artists;
+    HyperLogLog word_hll;
+    HyperLogLog artist_hll;
+} ApproxCounts;
+
+void approx_init(ApproxCounts *approx, int capacity) {
+    ss_init(&approx->words, capacity);
+    ss_init(&approx->artists, capacity);
+    hll_init(&approx->word_hll);
+    hll_init(&approx->artist_hll);
+}
+
+void approx_free(ApproxCounts *approx) {
+    ss_free(&approx->words);
+    ss_free(&approx->artists);
+}
+
+void approx_merge(ApproxCounts *dst, const ApproxCounts *src) {
+    ss_merge(&dst->words, &src->words);
+    ss_merge(&dst->artists, &src->artists);
+    hll_merge(&dst->word_hll, &src->word_hll);
+    hll_merge(&dst->artist_hll, &src->artist_hll);
+}
+
+// Destino das contagens: as tabelas exatas ou, se approx != NULL, os resumos
+typedef struct {
+    WordTable *words;
+    ArtistTable *artists;
+    ApproxCounts *approx;
+    long long tokens;       // palavras contadas (com repetição)
+    long long lines;        // linhas processadas
+} Counters;
+
+// Palavras de um único caractere (em UTF-8, até 4 bytes) são descartadas
+static inline int single_char_word(const char *word, size_t len) {
+    if (len > 4) return 0;
+    int chars = 0;
+    for (size_t i = 0; i < len; i++) chars += ((unsigned char)word[i] & 0xC0) != 0x80;
+    return chars < 2;
+}
+
+// Mesmos filtros de add_word/add_artist, para os dois modos contarem as mesmas chaves
+static void count_word(Counters *c, const char *word, size_t len) {
+    if (len < 2 || len >= MAX_WORD_LEN || single_char_word(word, len)) return;
+    c->tokens++;
+    if (c->approx == NULL) {
+        add_word(c->words, word, len, 1);
+    } else {
+        uint64_t h = sketch_hash(word, len);
+        ss_add(&c->approx->words, word, len, h, 1);
+        hll_add(&c->approx->word_hll, h);
     }
-    
-    // Adiciona nova palavra
-    if (*word_count >= *word_capacity) {
-        *word_capacity *= 2;
-        *words = realloc(*words, *word_capacity * sizeof(WordCount));
+}
+
+static void count_artist(Counters *c, const char *artist, size_t len) {
+    if (c->approx == NULL) {
+        add_artist(c->artists, artist, len, 1);
+    } else if (len > 0 && len < MAX_ARTIST_LEN) {
+        uint64_t h = sketch_hash(artist, len);
+        ss_add(&c->approx->artists, artist, len, h, 1);
+        hll_add(&c->approx->artist_hll, h);
     }
-    strncpy((*words)[*word_count].word, word, MAX_WORD_LEN - 1);
-    (*words)[*word_count].word[MAX_WORD_LEN - 1] = '\0';
-    (*words)[*word_count].count = 1;
-    (*word_count)++;
 }
 
-// Função para adicionar ou incrementar artista
-void add_artist(ArtistCount **artists, int *artist_count, int *artist_capacity, const char *artist) {
-    if (strlen(artist) == 0 || strlen(artist) >= MAX_ARTIST_LEN) return;
-    
-    // Procura se o artista já existe
-    for (int i = 0; i < *artist_count; i++) {
-        if (strcmp((*artists)[i].artist, artist) == 0) {
-            (*artists)[i].count++;
-            return;
+// Recebe cada palavra do tokenizador (count_word descarta as de tamanho < 2)
+static void count_word_token(void *ctx, const char *word, size_t len) {
+    count_word((Counters *)ctx, word, len);
+}
+
+// --- Registros CSV ---
+// Um campo entre aspas pode conter quebras de linha (o CSV original, sem o
+// pré-processamento), então um registro termina no primeiro '\n' *fora* de
+// aspas. Se uma posição está dentro de aspas é dado pela paridade do número de
+// aspas antes dela ("" escapado conta duas vezes e não muda a paridade).
+
+#define RECORD_NOT_FOUND ((size_t)-1)
+
+// Paridade (0 ou 1) do número de aspas em buf[0..len)
+static int quote_parity(const char *buf, size_t len) {
+    int parity = 0;
+    const char *end = buf + len;
+    for (const char *q = memchr(buf, '"', len); q != NULL; q = memchr(q + 1, '"', (size_t)(end - q - 1))) {
+        parity ^= 1;
+    }
+    return parity;
+}
+
+// Procura em buf[0..len) o primeiro '\n' fora de aspas, partindo do estado
+// *in_quotes. Retorna a posição logo após ele ou RECORD_NOT_FOUND; nesse caso
+// *in_quotes passa a ser o estado no fim de buf, para continuar a busca.
+static size_t next_record_start(const char *buf, size_t len, int *in_quotes) {
+    const char *p = buf, *end = buf + len;
+    const char *nl = NULL;   // próximo '\n' a partir de p (cada byte é lido no máximo duas vezes)
+    while (p < end) {
+        if (*in_quotes) {
+            const char *q = memchr(p, '"', (size_t)(end - p));
+            if (q == NULL) return RECORD_NOT_FOUND;
+            *in_quotes = 0;
+            p = q + 1;
+        } else {
+            if (nl == NULL || nl < p) {
+                nl = memchr(p, '\n', (size_t)(end - p));
+                if (nl == NULL) nl = end;
+            }
+            const char *q = memchr(p, '"', (size_t)(nl - p));
+            if (q == NULL) return nl < end ? (size_t)(nl + 1 - buf) : RECORD_NOT_FOUND;
+            *in_quotes = 1;
+            p = q + 1;
         }
     }
-    
-    // Adiciona novo artista
-    if (*artist_count >= *artist_capacity) {
-        *artist_capacity *= 2;
-        *artists = realloc(*artists, *artist_capacity * sizeof(ArtistCount));
+    return RECORD_NOT_FOUND;
+}
+
+// Primeiro início de registro em buf[pos..len], sabendo o estado em pos (len se não houver)
+static size_t record_start_in(const char *buf, size_t len, size_t pos, int in_quotes) {
+    if (pos == 0 || (buf[pos - 1] == '\n' && !in_quotes)) return pos;
+    size_t k = next_record_start(buf + pos, len - pos, &in_quotes);
+    return k == RECORD_NOT_FOUND ? len : pos + k;
+}
+
+// Tamanho da parte de buf[0..len) com registros completos (buf começa em um registro)
+static size_t complete_records(const char *buf, size_t len) {
+    size_t done = 0;
+    int in_quotes = 0;
+    for (;;) {
+        size_t k = next_record_start(buf + done, len - done, &in_quotes);
+        if (k == RECORD_NOT_FOUND) return done;
+        done += k;
     }
-    strncpy((*artists)[*artist_count].artist, artist, MAX_ARTIST_LEN - 1);
-    (*artists)[*artist_count].artist[MAX_ARTIST_LEN - 1] = '\0';
-    (*artists)[*artist_count].count = 1;
-    (*artist_count)++;
 }
 
-// Função para processar um chunk das linhas do CSV
-void process_chunk(char *chunk, size_t chunk_size, WordCount **words, int *word_count, int *word_capacity, ArtistCount **artists, int *artist_count, int *artist_capacity) {
+// Função para processar um chunk de registros do CSV (começa em um registro)
+void process_chunk(char *chunk, size_t chunk_size, Counters *counters) {
     char *line_start = chunk;
     char *line_end;
 
     while (line_start < chunk + chunk_size && *line_start) {
-        line_end = strchr(line_start, '\n');
-        if (line_end == NULL) {
-            line_end = chunk + chunk_size;
-        }
+        int in_quotes = 0;
+        size_t k = next_record_start(line_start, (size_t)(chunk + chunk_size - line_start), &in_quotes);
+        line_end = k == RECORD_NOT_FOUND ? chunk + chunk_size : line_start + k - 1;
         
         size_t line_len = line_end - line_start;
-        if (line_len > 0 && line_len < MAX_LINE_LEN) {
-            char line[MAX_LINE_LEN];
-            strncpy(line, line_start, line_len);
-            line[line_len] = '\0';
-            
+        if (line_len > 0) counters->lines++;
+        if (line_len > 0) {
             // Remove \r se existir
-            if (line_len > 0 && line[line_len - 1] == '\r') {
-                line[line_len - 1] = '\0';
-            }
-            
-            char *ptr = line;
-            
-            // Extrair campos: artist, song, link, text
-            char *artist_name = extract_csv_field(&ptr);
-            char *song = extract_csv_field(&ptr);
-            char *link = extract_csv_field(&ptr);
-            char *text = extract_csv_field(&ptr);
-            
-            if (artist_name != NULL && strlen(artist_name) > 0) {
+            if (line_start[line_len - 1] == '\r') line_len--;
+
+            // Campos: artist, song, link, text, como visões para o próprio
+            // chunk; só os usados têm as aspas desfeitas (no lugar)
+            CsvField fields[4];
+            int nf = csv_split(line_start, line_len, fields, 4);
+
+            if (fields[0].len > 0) {
                 // Adicionar artista
-                add_artist(artists, artist_count, artist_capacity, artist_name);
-                
-                // Processar texto (letra da música)
-                if (text != NULL && strlen(text) > 0) {
-                    // Tokenizar o texto em palavras
-                    char *word = strtok(text, " \t\n\r,.-?!\"()[]{}:;/\\");
-                    while (word != NULL) {
-                        // Converter para minúsculas
-                        for (int i = 0; word[i]; i++) {
-                            word[i] = tolower((unsigned char)word[i]);
-                        }
-                        
-                        // Verificar se a palavra tem pelo menos uma letra
-                        int has_alpha = 0;
-                        for (int i = 0; word[i]; i++) {
-                            if (isalpha((unsigned char)word[i])) {
-                                has_alpha = 1;
-                                break;
-                            }
-                        }
-                        
-                        if (has_alpha && strlen(word) >= 2) {
-                            add_word(words, word_count, word_capacity, word);
-                        }
-                        
-                        word = strtok(NULL, " \t\n\r,.-?!\"()[]{}:;/\\");
-                    }
+                char *artist_name = csv_field_unescape(&fields[0]);
+                count_artist(counters, artist_name, fields[0].len);
+
+                // Processar texto (letra da música): o tokenizador converte para
+                // minúsculas, no chunk, e entrega cada palavra com ao menos uma letra
+                if (nf == 4 && fields[3].len > 0) {
+                    char *text = csv_field_unescape(&fields[3]);
+                    tokenize_lower(text, fields[3].len, count_word_token, counters);
                 }
             }
         }
@@ -188,213 +453,1452 @@ void process_chunk(char *chunk, size_t chunk_size, WordCount **words, int *word_
     }
 }
 
+// Processa as músicas [begin, end) do corpus binário: os campos já estão
+// separados e as letras normalizadas, então não há parsing de CSV
+void process_corpus_rows(const Corpus *corpus, uint64_t begin, uint64_t end, Counters *counters) {
+    for (uint64_t row = begin; row < end; row++) {
+        size_t artist_len, text_len;
+        counters->lines++;
+        const char *artist_name = corpus_field(corpus, CORPUS_ARTIST, row, &artist_len);
+        if (artist_len == 0) continue;
+        count_artist(counters, artist_name, artist_len);
+
+        char *text = corpus_field(corpus, CORPUS_TEXT, row, &text_len);
+        if (text_len > 0) tokenize_lower(text, text_len, count_word_token, counters);
+    }
+}
+
+// Trabalho de uma thread: processa a parte part (de nparts) da entrada em counters
+typedef void (*PartWork)(void *arg, int part, int nparts, Counters *counters);
+
+// Executa work em nthreads threads; cada thread conta em tabelas (ou resumos)
+// próprios, que depois são mesclados em counters
+static void run_threaded(PartWork work, void *arg, Counters *counters, int nthreads) {
+    double t0 = MPI_Wtime();
+    if (nthreads <= 1) {
+        work(arg, 0, 1, counters);
+        rank_stats.time[PHASE_PROCESS] += MPI_Wtime() - t0;
+        return;
+    }
+
+    WordTable *local_words = xrealloc(NULL, nthreads * sizeof(WordTable));
+    ArtistTable *local_artists = xrealloc(NULL, nthreads * sizeof(ArtistTable));
+    ApproxCounts *local_approx = counters->approx ? xrealloc(NULL, nthreads * sizeof(ApproxCounts)) : NULL;
+    Counters *local = xrealloc(NULL, nthreads * sizeof(Counters));
+
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+    for (int t = 0; t < nthreads; t++) {
+        local[t] = (Counters){ &local_words[t], &local_artists[t], NULL, 0, 0 };
+        if (local_approx) {
+            approx_init(&local_approx[t], counters->approx->words.capacity);
+            local[t].approx = &local_approx[t];
+        } else {
+            count_table_init(&local_words[t]);
+            count_table_init(&local_artists[t]);
+        }
+        work(arg, t, nthreads, &local[t]);
+    }
+    double t1 = MPI_Wtime();
+    rank_stats.time[PHASE_PROCESS] += t1 - t0;
+
+    for (int t = 0; t < nthreads; t++) {
+        counters->tokens += local[t].tokens;
+        counters->lines += local[t].lines;
+        if (local_approx) {
+            approx_merge(counters->approx, &local_approx[t]);
+            approx_free(&local_approx[t]);
+            continue;
+        }
+        for (int i = 0; i < local_words[t].count; i++) {
+            const char *w = table_key(&local_words[t], i);
+            count_table_add(counters->words, w, strlen(w), local_words[t].items[i].count);
+        }
+        for (int i = 0; i < local_artists[t].count; i++) {
+            const char *a = table_key(&local_artists[t], i);
+            count_table_add(counters->artists, a, strlen(a), local_artists[t].items[i].count);
+        }
+        count_table_free(&local_words[t]);
+        count_table_free(&local_artists[t]);
+    }
+
+    free(local_words);
+    free(local_artists);
+    free(local_approx);
+    free(local);
+    rank_stats.time[PHASE_MERGE] += MPI_Wtime() - t1;
+}
+
+typedef struct {
+    char *chunk;
+    const size_t *bounds;   // bounds[t] é o início do sub-chunk t
+} ChunkParts;
+
+static void chunk_part_work(void *arg, int part, int nparts, Counters *counters) {
+    const ChunkParts *p = arg;
+    (void)nparts;
+    process_chunk(p->chunk + p->bounds[part], p->bounds[part + 1] - p->bounds[part], counters);
+}
+
+// Divide o chunk do rank em nthreads sub-chunks alinhados em registros; cada
+// thread conta em tabelas (ou resumos) próprios, que depois são mesclados em counters
+void process_chunk_threaded(char *chunk, size_t chunk_size, Counters *counters, int nthreads) {
+#ifndef _OPENMP
+    nthreads = 1;
+#endif
+    if (chunk_size == 0) nthreads = 1;
+
+    // bounds[t]: o primeiro início de registro a partir de chunk_size / nthreads * t.
+    // O estado das aspas em cada posição vem da paridade das fatias anteriores,
+    // contada em paralelo (o chunk começa fora de aspas).
+    size_t *bounds = xrealloc(NULL, (nthreads + 1) * sizeof(size_t));
+    int *parity = xrealloc(NULL, nthreads * sizeof(int));
+    size_t slice = chunk_size / nthreads;
+    #pragma omp parallel for num_threads(nthreads)
+    for (int t = 0; t < nthreads - 1; t++) {
+        parity[t] = quote_parity(chunk + slice * t, slice);
+    }
+    bounds[0] = 0;
+    bounds[nthreads] = chunk_size;
+    int in_quotes = 0;
+    for (int t = 1; t < nthreads; t++) {
+        in_quotes ^= parity[t - 1];
+        bounds[t] = record_start_in(chunk, chunk_size, slice * t, in_quotes);
+    }
+    free(parity);
+
+    ChunkParts parts = { chunk, bounds };
+    run_threaded(chunk_part_work, &parts, counters, nthreads);
+    free(bounds);
+}
+
+typedef struct {
+    const Corpus *corpus;
+    uint64_t begin, end;
+} CorpusParts;
+
+static void corpus_part_work(void *arg, int part, int nparts, Counters *counters) {
+    const CorpusParts *p = arg;
+    uint64_t begin, end;
+    corpus_split(p->corpus, p->begin, p->end, part, nparts, &begin, &end);
+    process_corpus_rows(p->corpus, begin, end, counters);
+}
+
+// Corpus binário: cada rank fica com uma faixa contígua de músicas com
+// quantidades parecidas de texto, repartida do mesmo modo entre as threads
+void process_corpus(const Corpus *corpus, int rank, int nprocs, Counters *counters, int nthreads) {
+#ifndef _OPENMP
+    nthreads = 1;
+#endif
+    CorpusParts parts = { corpus, 0, 0 };
+    corpus_split(corpus, 0, corpus->num_rows, rank, nprocs, &parts.begin, &parts.end);
+    if (corpus_check_rows(corpus, parts.begin, parts.end) != 0) {
+        fprintf(stderr, "Rank %d: corpus binário inconsistente nas músicas %llu a %llu\n", rank,
+                (unsigned long long)parts.begin, (unsigned long long)parts.end);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    const uint64_t *text_offsets = corpus->offsets[CORPUS_TEXT];
+    rank_stats.bytes += text_offsets[parts.end] - text_offsets[parts.begin];
+    run_threaded(corpus_part_work, &parts, counters, nthreads);
+}
+
+// Lê exatamente len bytes a partir de offset (em blocos, pois a contagem do MPI é int)
+static void read_at(MPI_File fh, MPI_Offset offset, char *buf, size_t len) {
+    const size_t max_block = 1 << 30;
+    while (len > 0) {
+        int n = (int)(len < max_block ? len : max_block);
+        MPI_Status status;
+        int got = 0;
+        if (MPI_File_read_at(fh, offset, buf, n, MPI_CHAR, &status) != MPI_SUCCESS) {
+            fprintf(stderr, "Erro de leitura no offset %lld\n", (long long)offset);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_Get_count(&status, MPI_CHAR, &got);
+        if (got <= 0) break;
+        offset += got;
+        buf += got;
+        len -= got;
+    }
+}
+
+// Primeiro início de registro em uma posição >= pos, dado o estado das aspas
+// em pos (paridade das aspas desde first, que é sempre início de registro).
+// Com pos == 0, o cabeçalho é pulado. Lê o arquivo em janelas pequenas a
+// partir de pos - 1 até achar um '\n' fora de aspas.
+MPI_Offset find_record_start(MPI_File fh, MPI_Offset file_size, MPI_Offset pos, int in_quotes) {
+    if (pos >= file_size) return file_size;
+    char window[64 * 1024];
+    MPI_Offset at = pos > 0 ? pos - 1 : 0;
+    size_t skip = (size_t)(pos - at);   // o byte anterior a pos só diz se pos já é início
+    while (at < file_size) {
+        size_t n = (size_t)((file_size - at) < (MPI_Offset)sizeof(window) ? (file_size - at) : (MPI_Offset)sizeof(window));
+        read_at(fh, at, window, n);
+        if (skip && window[0] == '\n' && !in_quotes) return pos;
+        size_t k = next_record_start(window + skip, n - skip, &in_quotes);
+        if (k != RECORD_NOT_FOUND) return at + (MPI_Offset)(skip + k);
+        at += n;
+        skip = 0;
+    }
+    return file_size;
+}
+
+// Paridade das aspas em [start, end) do arquivo, lido em blocos de buf_size bytes
+static int file_quote_parity(MPI_File fh, MPI_Offset start, MPI_Offset end, char *buf, size_t buf_size) {
+    int parity = 0;
+    for (MPI_Offset at = start; at < end; at += (MPI_Offset)buf_size) {
+        size_t n = (size_t)((end - at) < (MPI_Offset)buf_size ? (end - at) : (MPI_Offset)buf_size);
+        read_at(fh, at, buf, n);
+        parity ^= quote_parity(buf, n);
+    }
+    return parity;
+}
+
+// Estado das aspas no início da faixa deste rank: XOR das paridades das faixas
+// dos ranks anteriores (a primeira faixa começa em first, fora de aspas)
+static int quotes_before(int parity, int rank) {
+    int before = 0;
+    MPI_Exscan(&parity, &before, 1, MPI_INT, MPI_BXOR, MPI_COMM_WORLD);
+    return rank == 0 ? 0 : before;
+}
+
+// Os registros de um rank vão até o início dos registros do rank seguinte:
+// cada rank envia o seu begin ao vizinho anterior
+static MPI_Offset next_rank_begin(MPI_Offset begin, MPI_Offset file_size, int rank, int nprocs) {
+    MPI_Offset next = file_size;
+    MPI_Sendrecv(&begin, 1, MPI_OFFSET, rank > 0 ? rank - 1 : MPI_PROC_NULL, 4,
+                 &next, 1, MPI_OFFSET, rank + 1 < nprocs ? rank + 1 : MPI_PROC_NULL, 4,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return next;
+}
+
+// Faixa de bytes [*start, *end) deste rank: o trecho ainda não contabilizado
+// [first, file_size) é dividido em nprocs faixas de bytes iguais (first > 0 só
+// na reanálise incremental, e é sempre início de registro). Cada rank fica com
+// os registros que *começam* na sua faixa, então cada registro é processado
+// exatamente uma vez; o cabeçalho (registro que começa no byte 0) é descartado.
+static void rank_byte_range(MPI_Offset file_size, MPI_Offset first, int rank, int nprocs,
+                            MPI_Offset *start, MPI_Offset *end) {
+    *start = first + (file_size - first) * rank / nprocs;
+    *end = first + (file_size - first) * (rank + 1) / nprocs;
+}
+
+// Faixa [*begin, *finish) com os registros deste rank, sem manter a faixa em
+// memória: uma passada conta a paridade das aspas em blocos de buf_size bytes
+void rank_record_range(MPI_File fh, MPI_Offset file_size, MPI_Offset first, int rank, int nprocs,
+                       size_t buf_size, MPI_Offset *begin, MPI_Offset *finish) {
+    MPI_Offset start, end;
+    rank_byte_range(file_size, first, rank, nprocs, &start, &end);
+    char *buf = xrealloc(NULL, buf_size);
+    int parity = file_quote_parity(fh, start, end, buf, buf_size);
+    free(buf);
+    *begin = find_record_start(fh, file_size, start, quotes_before(parity, rank));
+    *finish = next_rank_begin(*begin, file_size, rank, nprocs);
+}
+
+// Lê com MPI-IO apenas os registros que pertencem a este rank. A faixa de
+// bytes do rank é lida de uma vez (com o byte anterior, que diz se ela já
+// começa em um registro) e a paridade das aspas é contada no próprio buffer;
+// depois da troca com os vizinhos, só falta ler o fim do último registro, que
+// invade a faixa seguinte. Retorna o buffer a liberar; *records aponta para os
+// *out_size bytes de registros completos, seguidos de '\0'.
+char *read_rank_records(MPI_File fh, MPI_Offset file_size, MPI_Offset first, int rank, int nprocs,
+                        char **records, size_t *out_size) {
+    MPI_Offset start, end;
+    rank_byte_range(file_size, first, rank, nprocs, &start, &end);
+    MPI_Offset at = start > 0 ? start - 1 : 0;
+    size_t skip = (size_t)(start - at);
+    size_t len = (size_t)(end - at);
+    char *buf = xrealloc(NULL, len + 1);
+    read_at(fh, at, buf, len);
+    int in_quotes = quotes_before(quote_parity(buf + skip, len - skip), rank);
+
+    MPI_Offset begin;
+    if (skip && len > 0 && buf[0] == '\n' && !in_quotes) {
+        begin = start;
+    } else {
+        size_t k = next_record_start(buf + skip, len - skip, &in_quotes);
+        begin = k != RECORD_NOT_FOUND ? start + (MPI_Offset)k : find_record_start(fh, file_size, end, in_quotes);
+    }
+    MPI_Offset finish = next_rank_begin(begin, file_size, rank, nprocs);
+
+    *out_size = (size_t)(finish - begin);
+    if (begin < end) {
+        // finish >= end: o que falta é o trecho [end, finish) da faixa seguinte
+        size_t offset = (size_t)(begin - at);
+        buf = xrealloc(buf, offset + *out_size + 1);
+        read_at(fh, end, buf + len, (size_t)(finish - end));
+        *records = buf + offset;
+    } else {
+        buf = xrealloc(buf, *out_size + 1);
+        read_at(fh, begin, buf, *out_size);
+        *records = buf;
+    }
+    (*records)[*out_size] = '\0';
+    rank_stats.bytes += (unsigned long long)len + (unsigned long long)(finish - (begin < end ? end : begin));
+    return buf;
+}
+
+// Modo streaming: processa os registros do rank em blocos de block_size bytes
+// com buffer duplo. Enquanto o bloco N é tokenizado, a leitura do bloco N+1
+// já foi disparada com MPI_File_iread_at. O registro incompleto no fim de um
+// bloco é copiado para o início do outro buffer, então a memória fica
+// limitada a 2 x (block_size + maior registro), independente do arquivo. Como
+// a faixa não fica em memória, a paridade das aspas é contada antes, em uma
+// passada extra de leitura.
+void process_stream(MPI_File fh, MPI_Offset file_size, MPI_Offset first, int rank, int nprocs,
+                    size_t block_size, Counters *counters, int nthreads) {
+    double t0 = MPI_Wtime();
+    MPI_Offset pos, finish;
+    rank_record_range(fh, file_size, first, rank, nprocs, block_size, &pos, &finish);
+    if (pos >= finish) {
+        rank_stats.time[PHASE_READ] += MPI_Wtime() - t0;
+        return;
+    }
+
+    char *buf[2];
+    size_t capacity[2];
+    for (int b = 0; b < 2; b++) {
+        capacity[b] = block_size + 1;
+        buf[b] = xrealloc(NULL, capacity[b]);
+    }
+
+    MPI_Request request;
+    int cur = 0;
+    size_t carry = 0;     // bytes do registro incompleto já no início de buf[cur]
+    int pending = (int)((finish - pos) < (MPI_Offset)block_size ? (finish - pos) : (MPI_Offset)block_size);
+    MPI_File_iread_at(fh, pos, buf[cur], pending, MPI_CHAR, &request);
+    rank_stats.time[PHASE_READ] += MPI_Wtime() - t0;
+
+    while (pending > 0) {
+        MPI_Status status;
+        int got = 0;
+        // Só o tempo em que o processamento ficou esperando pelo I/O conta como leitura
+        t0 = MPI_Wtime();
+        MPI_Wait(&request, &status);
+        rank_stats.time[PHASE_READ] += MPI_Wtime() - t0;
+        MPI_Get_count(&status, MPI_CHAR, &got);
+        if (got <= 0) {
+            fprintf(stderr, "[rank %d] Erro de leitura no offset %lld\n", rank, (long long)pos);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        pos += got;
+        rank_stats.bytes += (unsigned long long)got;
+        size_t data_len = carry + (size_t)got;
+        size_t complete = data_len;
+        int next = 1 - cur;
+
+        pending = (int)((finish - pos) < (MPI_Offset)block_size ? (finish - pos) : (MPI_Offset)block_size);
+        if (pending > 0) {
+            // Só os registros completos são processados agora; o resto vai para o outro buffer
+            complete = complete_records(buf[cur], data_len);
+            carry = data_len - complete;
+            if (carry + block_size + 1 > capacity[next]) {
+                capacity[next] = carry + block_size + 1;
+                buf[next] = xrealloc(buf[next], capacity[next]);
+            }
+            memcpy(buf[next], buf[cur] + complete, carry);
+            MPI_File_iread_at(fh, pos, buf[next] + carry, pending, MPI_CHAR, &request);
+        }
+
+        buf[cur][complete] = '\0';
+        process_chunk_threaded(buf[cur], complete, counters, nthreads);
+        cur = next;
+    }
+
+    free(buf[0]);
+    free(buf[1]);
+}
+
+// Escalonamento dinâmico: em vez de uma faixa fixa por rank, o arquivo (a partir de
+// first) é dividido em blocos de block_size bytes distribuídos sob demanda. O próximo
+// bloco livre é um contador em uma janela RMA do rank 0, incrementado com
+// MPI_Fetch_and_op (acesso passivo: o rank 0 não precisa atender pedidos e
+// também processa blocos). Assim, quem termina antes simplesmente pega mais
+// blocos, e o rank mais lento atrasa o fim em no máximo um bloco.
+//
+// Para achar os limites de registro de qualquer bloco, antes é preciso saber
+// o estado das aspas no início de cada um: os ranks contam a paridade de
+// faixas contíguas de blocos, combinadas com MPI_Allreduce (XOR), e o prefixo
+// das paridades dá o estado de cada bloco (uma passada extra de leitura).
+static unsigned char *block_quote_states(MPI_File fh, MPI_Offset file_size, MPI_Offset first, int rank,
+                                         int nprocs, size_t block_size, long long *nblocks) {
+    *nblocks = (long long)((file_size - first + (MPI_Offset)block_size - 1) / (MPI_Offset)block_size);
+    unsigned char *parity = calloc((size_t)*nblocks + 1, 1);
+    unsigned char *states = calloc((size_t)*nblocks + 1, 1);
+    char *buf = xrealloc(NULL, block_size);
+    if (parity == NULL || states == NULL) {
+        fprintf(stderr, "[rank %d] Erro: memória insuficiente\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (long long b = *nblocks * rank / nprocs; b < *nblocks * (rank + 1) / nprocs; b++) {
+        MPI_Offset start = first + (MPI_Offset)b * (MPI_Offset)block_size;
+        MPI_Offset end = start + (MPI_Offset)block_size < file_size ? start + (MPI_Offset)block_size : file_size;
+        parity[b] = (unsigned char)file_quote_parity(fh, start, end, buf, block_size);
+    }
+    free(buf);
+    MPI_Allreduce(MPI_IN_PLACE, parity, (int)*nblocks, MPI_UNSIGNED_CHAR, MPI_BXOR, MPI_COMM_WORLD);
+    for (long long b = 0; b < *nblocks; b++) states[b + 1] = states[b] ^ parity[b];
+    free(parity);
+    return states;
+}
+
+void process_dynamic(MPI_File fh, MPI_Offset file_size, MPI_Offset first, int rank, int nprocs,
+                     size_t block_size, Counters *counters, int nthreads) {
+    double t_states = MPI_Wtime();
+    long long nblocks;
+    unsigned char *states = block_quote_states(fh, file_size, first, rank, nprocs, block_size, &nblocks);
+    rank_stats.time[PHASE_READ] += MPI_Wtime() - t_states;
+
+    long long *next_block;
+    MPI_Win win;
+    MPI_Win_allocate(rank == 0 ? sizeof(long long) : 0, sizeof(long long), MPI_INFO_NULL,
+                     MPI_COMM_WORLD, &next_block, &win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win);
+        *next_block = 0;
+        MPI_Win_unlock(0, win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    char *buf = NULL;
+    size_t capacity = 0;
+    MPI_Win_lock_all(0, win);
+    for (;;) {
+        double t0 = MPI_Wtime();
+        long long one = 1, block;
+        MPI_Fetch_and_op(&one, &block, MPI_LONG_LONG, 0, 0, MPI_SUM, win);
+        MPI_Win_flush(0, win);
+        MPI_Offset start = first + (MPI_Offset)block * (MPI_Offset)block_size;
+        if (block >= nblocks) {
+            rank_stats.time[PHASE_READ] += MPI_Wtime() - t0;
+            break;
+        }
+        MPI_Offset end = start + (MPI_Offset)block_size < file_size ? start + (MPI_Offset)block_size : file_size;
+
+        // Registros que começam no bloco: do primeiro início em start ao primeiro em end
+        MPI_Offset begin = find_record_start(fh, file_size, start, states[block]);
+        MPI_Offset finish = find_record_start(fh, file_size, end, states[block + 1]);
+        size_t len = (size_t)(finish - begin);
+        if (len + 1 > capacity) {
+            capacity = len + 1;
+            buf = xrealloc(buf, capacity);
+        }
+        read_at(fh, begin, buf, len);
+        buf[len] = '\0';
+        rank_stats.bytes += len;
+        rank_stats.time[PHASE_READ] += MPI_Wtime() - t0;
+
+        process_chunk_threaded(buf, len, counters, nthreads);
+    }
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    free(buf);
+    free(states);
+}
+
+// --- Redução distribuída dos resultados ---
+
+typedef enum {
+    REDUCE_MASTER,  // rank 0 recebe e mescla as tabelas de todos (modo original)
+    REDUCE_TREE,    // mescla em árvore binária: log2(nprocs) rodadas em paralelo
+    REDUCE_HASH,    // shuffle por hash: cada rank fica dono de uma fatia do vocabulário
+    REDUCE_TOPK     // top-K distribuído exato (TPUT): só candidatos saem de cada rank
+} ReduceMode;
+
+// Volume trocado entre ranks: bytes efetivamente enviados e o equivalente no
+// formato antigo (structs de tamanho fixo: chave de MAX_WORD_LEN ou MAX_ARTIST_LEN
+// bytes + contagem)
+static unsigned long long wire_bytes_sent = 0;
+static unsigned long long raw_bytes_equiv = 0;
+static int wire_compress = 0;
+
+// Monta referências (chave, contagem) para n itens das tabelas: os itens
+// idx[0..n) ou, com idx == NULL, os n primeiros
+static KeyCountRef *table_refs(const CountTable *table, const int *idx, int n) {
+    KeyCountRef *refs = xrealloc(NULL, (n > 0 ? n : 1) * sizeof(KeyCountRef));
+    for (int i = 0; i < n; i++) {
+        int item = idx ? idx[i] : i;
+        refs[i].key = table_key(table, item);
+        refs[i].len = (int)strlen(refs[i].key);
+        refs[i].count = table->items[item].count;
+    }
+    return refs;
+}
+
+// Codifica um par de blocos (palavras, artistas) no formato compacto.
+// Retorna o tamanho que os mesmos itens teriam no formato antigo.
+static unsigned long long encode_tables(ByteBuf *out, KeyCountRef *wrefs, int nw, KeyCountRef *arefs, int na) {
+    wire_encode(out, wrefs, nw, wire_compress);
+    wire_encode(out, arefs, na, wire_compress);
+    return (unsigned long long)nw * (MAX_WORD_LEN + sizeof(int)) + (unsigned long long)na * (MAX_ARTIST_LEN + sizeof(int));
+}
+
+// Decodifica um par de blocos (palavras, artistas) e soma nas tabelas locais.
+// Com count_reports, soma 1 por chave (quantos ranks a reportaram) em vez da
+// contagem. Retorna o número de bytes consumidos de data.
+static size_t decode_merge_tables(const unsigned char *data, size_t size, WordTable *words, ArtistTable *artists,
+                                  int count_reports) {
+    size_t offset = 0;
+    for (int block = 0; block < 2; block++) {
+        WireReader reader;
+        size_t consumed;
+        int count, status;
+        if (wire_reader_init(&reader, data + offset, size - offset, &consumed) < 0) {
+            fprintf(stderr, "Erro: bloco de contagens corrompido\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        while ((status = wire_next(&reader, &count)) > 0) {
+            if (count_reports) count = 1;
+            if (block == 0) add_word(words, reader.key, reader.key_len, count);
+            else add_artist(artists, reader.key, reader.key_len, count);
+        }
+        wire_reader_free(&reader);
+        if (status < 0) {
+            fprintf(stderr, "Erro: bloco de contagens corrompido\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        offset += consumed;
+    }
+    return offset;
+}
+
+// Envia as tabelas completas deste rank para dest
+void send_tables(const WordTable *words, const ArtistTable *artists, int dest) {
+    KeyCountRef *wrefs = table_refs(words, NULL, words->count);
+    KeyCountRef *arefs = table_refs(artists, NULL, artists->count);
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    raw_bytes_equiv += encode_tables(&buf, wrefs, words->count, arefs, artists->count);
+    MPI_Send(buf.data, (int)buf.size, MPI_BYTE, dest, 2, MPI_COMM_WORLD);
+    wire_bytes_sent += buf.size;
+    bytebuf_free(&buf);
+    free(wrefs);
+    free(arefs);
+}
+
+// Recebe as tabelas de src e mescla nas tabelas locais
+void recv_merge_tables(WordTable *words, ArtistTable *artists, int src) {
+    MPI_Status status;
+    int size;
+    MPI_Probe(src, 2, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_BYTE, &size);
+    unsigned char *buf = xrealloc(NULL, size > 0 ? size : 1);
+    MPI_Recv(buf, size, MPI_BYTE, src, 2, MPI_COMM_WORLD, &status);
+    decode_merge_tables(buf, size, words, artists, 0);
+    free(buf);
+}
+
+// Modo original: o master recebe e mescla as tabelas de cada slave em sequência
+void reduce_master(WordTable *words, ArtistTable *artists, int rank, int nprocs) {
+    if (rank == 0) {
+        for (int i = 1; i < nprocs; i++) {
+            recv_merge_tables(words, artists, i);
+        }
+    } else {
+        send_tables(words, artists, 0);
+    }
+}
+
+// Mescla em árvore binária: na rodada com passo s, o rank r (múltiplo de 2s)
+// recebe de r + s. As mesclas de cada rodada acontecem em paralelo e o
+// rank 0 termina com as tabelas completas após ceil(log2(nprocs)) rodadas.
+void reduce_tree(WordTable *words, ArtistTable *artists, int rank, int nprocs) {
+    for (int step = 1; step < nprocs; step *= 2) {
+        if (rank % (2 * step) == step) {
+            send_tables(words, artists, rank - step);
+            return;
+        }
+        if (rank % (2 * step) == 0 && rank + step < nprocs) {
+            recv_merge_tables(words, artists, rank + step);
+        }
+    }
+}
+
+// Finalizador do MurmurHash3: redistribui os bits do hash para que o rank dono
+// não dependa dos bits baixos, que também indexam a tabela local
+static inline unsigned int mix_hash(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline int owner_rank(const char *key, int len, int nprocs) {
+    unsigned int h = mix_hash(hash_string(key, len));
+    return (int)(((uint64_t)h * (uint64_t)nprocs) >> 32);
+}
+
+// Agrupa as referências por rank dono (ordenação estável por contagem)
+static KeyCountRef *group_by_owner(const KeyCountRef *refs, int n, int nprocs, int *per_rank) {
+    KeyCountRef *grouped = xrealloc(NULL, (n > 0 ? n : 1) * sizeof(KeyCountRef));
+    int *owners = xrealloc(NULL, (n > 0 ? n : 1) * sizeof(int));
+    int *fill = calloc(nprocs, sizeof(int));
+    memset(per_rank, 0, nprocs * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        owners[i] = owner_rank(refs[i].key, refs[i].len, nprocs);
+        per_rank[owners[i]]++;
+    }
+    for (int r = 1; r < nprocs; r++) fill[r] = fill[r - 1] + per_rank[r - 1];
+    for (int i = 0; i < n; i++) grouped[fill[owners[i]]++] = refs[i];
+    free(fill);
+    free(owners);
+    return grouped;
+}
+
+// Redistribui as tabelas para o rank dono de cada chave com um único
+// MPI_Alltoallv, já no formato compacto, e substitui as tabelas locais pela
+// fatia do vocabulário que pertence a este rank
+void shuffle_by_owner(WordTable *words, ArtistTable *artists, int rank, int nprocs) {
+    int *w_per_rank = xrealloc(NULL, nprocs * sizeof(int));
+    int *a_per_rank = xrealloc(NULL, nprocs * sizeof(int));
+    int *send_counts = xrealloc(NULL, nprocs * sizeof(int));
+    int *recv_counts = xrealloc(NULL, nprocs * sizeof(int));
+    int *send_displs = xrealloc(NULL, nprocs * sizeof(int));
+    int *recv_displs = xrealloc(NULL, nprocs * sizeof(int));
+
+    KeyCountRef *all_w = table_refs(words, NULL, words->count);
+    KeyCountRef *all_a = table_refs(artists, NULL, artists->count);
+    KeyCountRef *wrefs = group_by_owner(all_w, words->count, nprocs, w_per_rank);
+    KeyCountRef *arefs = group_by_owner(all_a, artists->count, nprocs, a_per_rank);
+    free(all_w);
+    free(all_a);
+
+    // Um par de blocos (palavras, artistas) por destino
+    ByteBuf send_buf;
+    bytebuf_init(&send_buf);
+    int w_off = 0, a_off = 0;
+    for (int r = 0; r < nprocs; r++) {
+        size_t before = send_buf.size;
+        unsigned long long raw = encode_tables(&send_buf, wrefs + w_off, w_per_rank[r], arefs + a_off, a_per_rank[r]);
+        send_displs[r] = (int)before;
+        send_counts[r] = (int)(send_buf.size - before);
+        // A fatia que fica no próprio rank não passa pela rede
+        if (r != rank) {
+            wire_bytes_sent += send_counts[r];
+            raw_bytes_equiv += raw;
+        }
+        w_off += w_per_rank[r];
+        a_off += a_per_rank[r];
+    }
+
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    int recv_total = 0;
+    for (int r = 0; r < nprocs; r++) {
+        recv_displs[r] = recv_total;
+        recv_total += recv_counts[r];
+    }
+    unsigned char *recv_buf = xrealloc(NULL, recv_total > 0 ? recv_total : 1);
+    MPI_Alltoallv(send_buf.data, send_counts, send_displs, MPI_BYTE,
+                  recv_buf, recv_counts, recv_displs, MPI_BYTE, MPI_COMM_WORLD);
+
+    // As referências apontam para as tabelas antigas: só libera após codificar
+    bytebuf_free(&send_buf);
+    free(wrefs);
+    free(arefs);
+    count_table_free(words);
+    count_table_free(artists);
+    count_table_init(words);
+    count_table_init(artists);
+    for (int r = 0; r < nprocs; r++) {
+        decode_merge_tables(recv_buf + recv_displs[r], recv_counts[r], words, artists, 0);
+    }
+
+    free(recv_buf);
+    free(w_per_rank);
+    free(a_per_rank);
+    free(send_counts);
+    free(recv_counts);
+    free(send_displs);
+    free(recv_displs);
+}
+
+// Junta no rank 0 o buffer codificado de cada rank (MPI_Gatherv).
+// No rank 0 retorna a concatenação e preenche counts/displs (a liberar);
+// nos demais retorna NULL.
+unsigned char *gather_encoded(const ByteBuf *buf, unsigned long long raw, int rank, int nprocs,
+                              int **counts, int **displs) {
+    int size = (int)buf->size;
+    unsigned char *all = NULL;
+    *counts = *displs = NULL;
+    if (rank != 0) {
+        wire_bytes_sent += buf->size;
+        raw_bytes_equiv += raw;
+    } else {
+        *counts = xrealloc(NULL, nprocs * sizeof(int));
+        *displs = xrealloc(NULL, nprocs * sizeof(int));
+    }
+    MPI_Gather(&size, 1, MPI_INT, *counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        int total = 0;
+        for (int r = 0; r < nprocs; r++) {
+            (*displs)[r] = total;
+            total += (*counts)[r];
+        }
+        all = xrealloc(NULL, total > 0 ? total : 1);
+    }
+    MPI_Gatherv(buf->data, size, MPI_BYTE, all, *counts, *displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+    return all;
+}
+
+// Junta no rank 0 os itens word_idx/artist_idx de cada rank e substitui as
+// tabelas do rank 0 pela soma desses candidatos
+void gather_candidates(WordTable *words, ArtistTable *artists, const int *word_idx, int word_cands,
+                       const int *artist_idx, int artist_cands, int rank, int nprocs) {
+    KeyCountRef *wrefs = table_refs(words, word_idx, word_cands);
+    KeyCountRef *arefs = table_refs(artists, artist_idx, artist_cands);
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    unsigned long long raw = encode_tables(&buf, wrefs, word_cands, arefs, artist_cands);
+
+    int *counts, *displs;
+    unsigned char *all = gather_encoded(&buf, raw, rank, nprocs, &counts, &displs);
+    bytebuf_free(&buf);
+    free(wrefs);
+    free(arefs);
+
+    if (rank == 0) {
+        count_table_free(words);
+        count_table_free(artists);
+        count_table_init(words);
+        count_table_init(artists);
+        for (int r = 0; r < nprocs; r++) {
+            decode_merge_tables(all + displs[r], counts[r], words, artists, 0);
+        }
+        free(all);
+        free(counts);
+        free(displs);
+    }
+}
+
+// Shuffle por hash: cada palavra/artista vai para um único rank dono, que soma
+// as contagens da sua fatia. Como as fatias são disjuntas, o top-N global está
+// contido na união dos top-N locais: só esses candidatos e os totais de
+// chaves únicas vão para o rank 0. No rank 0, words/artists terminam contendo
+// apenas os candidatos; os totais exatos são devolvidos em unique_*.
+// Esta é a segunda etapa, após shuffle_by_owner; entre as duas, cada rank tem
+// a contagem completa da sua fatia (é quando o snapshot é gravado).
+void reduce_hash_candidates(WordTable *words, ArtistTable *artists, int rank, int nprocs,
+                            long long *unique_words, long long *unique_artists) {
+    long long local_unique[2] = { words->count, artists->count };
+    long long global_unique[2] = { 0, 0 };
+    MPI_Reduce(local_unique, global_unique, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    *unique_words = global_unique[0];
+    *unique_artists = global_unique[1];
+
+    // Top-N local de cada fatia
+    int word_idx[TOP_N], artist_idx[TOP_N];
+    int word_cands = select_top_k(words, TOP_N, word_idx);
+    int artist_cands = select_top_k(artists, TOP_N, artist_idx);
+    gather_candidates(words, artists, word_idx, word_cands, artist_idx, artist_cands, rank, nprocs);
+}
+
+// FNV-1a de 64 bits, usado como impressão digital das chaves
+static inline uint64_t hash64_string(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Conta as chaves distintas de todos os ranks sem juntar as tabelas: cada
+// chave vira uma impressão digital de 64 bits enviada ao rank dono, que
+// ordena e conta as distintas (exato, salvo colisões de 64 bits).
+// O total só é válido no rank 0.
+long long count_unique_keys(const KeyCountRef *refs, int n, int rank, int nprocs) {
+    int *send_counts = calloc(nprocs, sizeof(int));
+    int *recv_counts = xrealloc(NULL, nprocs * sizeof(int));
+    int *send_displs = xrealloc(NULL, nprocs * sizeof(int));
+    int *recv_displs = xrealloc(NULL, nprocs * sizeof(int));
+    int *fill = xrealloc(NULL, nprocs * sizeof(int));
+    uint64_t *prints = xrealloc(NULL, (n > 0 ? n : 1) * sizeof(uint64_t));
+    uint64_t *send_buf = xrealloc(NULL, (n > 0 ? n : 1) * sizeof(uint64_t));
+
+    for (int i = 0; i < n; i++) {
+        prints[i] = hash64_string(refs[i].key, refs[i].len);
+        send_counts[(int)(((prints[i] >> 32) * (uint64_t)nprocs) >> 32)]++;
+    }
+    int total = 0;
+    for (int r = 0; r < nprocs; r++) {
+        send_displs[r] = fill[r] = total;
+        total += send_counts[r];
+        if (r != rank) wire_bytes_sent += send_counts[r] * sizeof(uint64_t);
+    }
+    for (int i = 0; i < n; i++) {
+        send_buf[fill[(int)(((prints[i] >> 32) * (uint64_t)nprocs) >> 32)]++] = prints[i];
+    }
+
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    total = 0;
+    for (int r = 0; r < nprocs; r++) {
+        recv_displs[r] = total;
+        total += recv_counts[r];
+    }
+    uint64_t *recv_buf = xrealloc(NULL, (total > 0 ? total : 1) * sizeof(uint64_t));
+    MPI_Alltoallv(send_buf, send_counts, send_displs, MPI_UINT64_T,
+                  recv_buf, recv_counts, recv_displs, MPI_UINT64_T, MPI_COMM_WORLD);
+
+    qsort(recv_buf, total, sizeof(uint64_t), compare_u64);
+    long long distinct = 0, global = 0;
+    for (int i = 0; i < total; i++) {
+        if (i == 0 || recv_buf[i] != recv_buf[i - 1]) distinct++;
+    }
+    MPI_Reduce(&distinct, &global, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    free(recv_buf);
+    free(send_buf);
+    free(prints);
+    free(fill);
+    free(send_counts);
+    free(recv_counts);
+    free(send_displs);
+    free(recv_displs);
+    return global;
+}
+
+// Contagem do k-ésimo melhor item da tabela (0 se ela tiver menos de k itens)
+static int kth_count(const CountTable *table, int k) {
+    int idx[TOP_N];
+    int n = select_top_k(table, k, idx);
+    return n < k ? 0 : table->items[idx[k - 1]].count;
+}
+
+// Junta no rank 0 os itens selecionados de cada rank, somando as contagens em
+// sums e (se reports != NULL) o número de ranks que reportaram cada chave
+static void gather_into(const WordTable *words, const ArtistTable *artists, const int *word_idx, int nw,
+                        const int *artist_idx, int na, int rank, int nprocs,
+                        WordTable *sum_words, ArtistTable *sum_artists,
+                        WordTable *report_words, ArtistTable *report_artists) {
+    KeyCountRef *wrefs = table_refs(words, word_idx, nw);
+    KeyCountRef *arefs = table_refs(artists, artist_idx, na);
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    unsigned long long raw = encode_tables(&buf, wrefs, nw, arefs, na);
+    int *counts, *displs;
+    unsigned char *all = gather_encoded(&buf, raw, rank, nprocs, &counts, &displs);
+    bytebuf_free(&buf);
+    free(wrefs);
+    free(arefs);
+    if (rank != 0) return;
+
+    for (int r = 0; r < nprocs; r++) {
+        decode_merge_tables(all + displs[r], counts[r], sum_words, sum_artists, 0);
+        if (report_words) decode_merge_tables(all + displs[r], counts[r], report_words, report_artists, 1);
+    }
+    free(all);
+    free(counts);
+    free(displs);
+}
+
+// Top-K distribuído exato no estilo TPUT ("Three-Phase Uniform Threshold"),
+// sem juntar as tabelas. Com m ranks e K = TOP_N:
+//   1. Cada rank envia seu top-K local. Somando-os, o rank 0 obtém tau1, o
+//      K-ésimo maior total parcial, e difunde o limiar T = ceil(tau1 / m).
+//   2. Cada rank envia os itens com contagem local >= T (e seu top-K local).
+//      Um item com total >= tau1 tem contagem >= T em algum rank, logo foi
+//      visto; os não vistos somam no máximo m * (T - 1) < tau1. Com tau2, o
+//      K-ésimo maior total parcial desta fase (tau2 >= tau1), um item só pode
+//      estar no top-K se parcial + (ranks que não o reportaram) * (T - 1) >= tau2.
+//   3. Os candidatos que passam nesse limite superior são difundidos e cada
+//      rank devolve suas contagens exatas para eles.
+// O resultado é idêntico ao da redução completa, inclusive nos empates.
+// No rank 0, words/artists terminam com os candidatos e seus totais exatos.
+void reduce_topk(WordTable *words, ArtistTable *artists, int rank, int nprocs,
+                 long long *unique_words, long long *unique_artists) {
+    KeyCountRef *refs = table_refs(words, NULL, words->count);
+    *unique_words = count_unique_keys(refs, words->count, rank, nprocs);
+    free(refs);
+    refs = table_refs(artists, NULL, artists->count);
+    *unique_artists = count_unique_keys(refs, artists->count, rank, nprocs);
+    free(refs);
+
+    // Fase 1: top-K local
+    int word_top[TOP_N], artist_top[TOP_N];
+    int nw = select_top_k(words, TOP_N, word_top);
+    int na = select_top_k(artists, TOP_N, artist_top);
+    WordTable sum_words, report_words;
+    ArtistTable sum_artists, report_artists;
+    count_table_init(&sum_words);
+    count_table_init(&sum_artists);
+    gather_into(words, artists, word_top, nw, artist_top, na, rank, nprocs, &sum_words, &sum_artists, NULL, NULL);
+
+    int threshold[2] = { 0, 0 };
+    if (rank == 0) {
+        threshold[0] = (kth_count(&sum_words, TOP_N) + nprocs - 1) / nprocs;
+        threshold[1] = (kth_count(&sum_artists, TOP_N) + nprocs - 1) / nprocs;
+    }
+    MPI_Bcast(threshold, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    count_table_free(&sum_words);
+    count_table_free(&sum_artists);
+
+    // Fase 2: itens acima do limiar (o top-K local tem contagem >= a do K-ésimo local)
+    int local_kth_word = nw > 0 ? words->items[word_top[nw - 1]].count : 0;
+    int local_kth_artist = na > 0 ? artists->items[artist_top[na - 1]].count : 0;
+    int word_limit = threshold[0] < local_kth_word ? threshold[0] : local_kth_word;
+    int artist_limit = threshold[1] < local_kth_artist ? threshold[1] : local_kth_artist;
+    int *word_sel = xrealloc(NULL, (words->count > 0 ? words->count : 1) * sizeof(int));
+    int *artist_sel = xrealloc(NULL, (artists->count > 0 ? artists->count : 1) * sizeof(int));
+    nw = na = 0;
+    for (int i = 0; i < words->count; i++) {
+        if (words->items[i].count >= word_limit) word_sel[nw++] = i;
+    }
+    for (int i = 0; i < artists->count; i++) {
+        if (artists->items[i].count >= artist_limit) artist_sel[na++] = i;
+    }
+    count_table_init(&sum_words);
+    count_table_init(&sum_artists);
+    count_table_init(&report_words);
+    count_table_init(&report_artists);
+    gather_into(words, artists, word_sel, nw, artist_sel, na, rank, nprocs,
+                &sum_words, &sum_artists, &report_words, &report_artists);
+
+    // Candidatos: itens cujo limite superior alcança tau2
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    if (rank == 0) {
+        long long tau_word = kth_count(&sum_words, TOP_N);
+        long long tau_artist = kth_count(&sum_artists, TOP_N);
+        long long slack_word = threshold[0] > 0 ? threshold[0] - 1 : 0;
+        long long slack_artist = threshold[1] > 0 ? threshold[1] - 1 : 0;
+        int *cand_words = xrealloc(NULL, (sum_words.count > 0 ? sum_words.count : 1) * sizeof(int));
+        int *cand_artists = xrealloc(NULL, (sum_artists.count > 0 ? sum_artists.count : 1) * sizeof(int));
+        nw = na = 0;
+        for (int i = 0; i < sum_words.count; i++) {
+            const char *w = table_key(&sum_words, i);
+            int reports = report_words.items[count_table_find(&report_words, w, strlen(w))].count;
+            if (sum_words.items[i].count + (nprocs - reports) * slack_word >= tau_word) cand_words[nw++] = i;
+        }
+        for (int i = 0; i < sum_artists.count; i++) {
+            const char *a = table_key(&sum_artists, i);
+            int reports = report_artists.items[count_table_find(&report_artists, a, strlen(a))].count;
+            if (sum_artists.items[i].count + (nprocs - reports) * slack_artist >= tau_artist) cand_artists[na++] = i;
+        }
+        KeyCountRef *wrefs = table_refs(&sum_words, cand_words, nw);
+        KeyCountRef *arefs = table_refs(&sum_artists, cand_artists, na);
+        unsigned long long raw = encode_tables(&buf, wrefs, nw, arefs, na);
+        wire_bytes_sent += buf.size * (unsigned long long)(nprocs - 1);
+        raw_bytes_equiv += raw * (unsigned long long)(nprocs - 1);
+        free(wrefs);
+        free(arefs);
+        free(cand_words);
+        free(cand_artists);
+    }
+    count_table_free(&sum_words);
+    count_table_free(&sum_artists);
+    count_table_free(&report_words);
+    count_table_free(&report_artists);
+
+    // Fase 3: difunde os candidatos e coleta as contagens exatas de cada rank
+    int size = (int)buf.size;
+    MPI_Bcast(&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank != 0) {
+        buf.data = xrealloc(NULL, size > 0 ? size : 1);
+        buf.size = buf.capacity = size;
+    }
+    MPI_Bcast(buf.data, size, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    nw = na = 0;
+    size_t offset = 0;
+    for (int block = 0; block < 2; block++) {
+        WireReader reader;
+        size_t consumed;
+        int count, status;
+        if (wire_reader_init(&reader, buf.data + offset, buf.size - offset, &consumed) < 0) {
+            fprintf(stderr, "Erro: bloco de candidatos corrompido\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        while ((status = wire_next(&reader, &count)) > 0) {
+            int idx = block == 0 ? count_table_find(words, reader.key, reader.key_len)
+                                 : count_table_find(artists, reader.key, reader.key_len);
+            if (idx < 0) continue;
+            if (block == 0) word_sel[nw++] = idx;
+            else artist_sel[na++] = idx;
+        }
+        wire_reader_free(&reader);
+        if (status < 0) {
+            fprintf(stderr, "Erro: bloco de candidatos corrompido\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        offset += consumed;
+    }
+    bytebuf_free(&buf);
+
+    WordTable exact_words;
+    ArtistTable exact_artists;
+    count_table_init(&exact_words);
+    count_table_init(&exact_artists);
+    gather_into(words, artists, word_sel, nw, artist_sel, na, rank, nprocs,
+                &exact_words, &exact_artists, NULL, NULL);
+    free(word_sel);
+    free(artist_sel);
+
+    count_table_free(words);
+    count_table_free(artists);
+    *words = exact_words;
+    *artists = exact_artists;
+}
+
+// Modo aproximado: os resumos Space-Saving são mesclados em árvore binária
+// (como reduce_tree, mas com mensagens de tamanho limitado pela capacidade) e
+// os registradores do HyperLogLog pelo máximo, ambos terminando no rank 0
+void reduce_approx(ApproxCounts *approx, int rank, int nprocs) {
+    for (int step = 1; step < nprocs; step *= 2) {
+        if (rank % (2 * step) == step) {
+            ByteBuf buf;
+            bytebuf_init(&buf);
+            ss_serialize(&approx->words, &buf);
+            ss_serialize(&approx->artists, &buf);
+            MPI_Send(buf.data, (int)buf.size, MPI_BYTE, rank - step, 3, MPI_COMM_WORLD);
+            wire_bytes_sent += buf.size;
+            bytebuf_free(&buf);
+            break;
+        }
+        if (rank % (2 * step) == 0 && rank + step < nprocs) {
+            MPI_Status status;
+            int size;
+            MPI_Probe(rank + step, 3, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, MPI_BYTE, &size);
+            unsigned char *data = xrealloc(NULL, size > 0 ? size : 1);
+            MPI_Recv(data, size, MPI_BYTE, rank + step, 3, MPI_COMM_WORLD, &status);
+
+            size_t first = 0, second = 0;
+            int ok = ss_merge_serialized(&approx->words, data, size, &first) == 0 &&
+                     ss_merge_serialized(&approx->artists, data + first, size - first, &second) == 0;
+            free(data);
+            if (!ok) {
+                fprintf(stderr, "Erro: resumo aproximado corrompido\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+
+    void *send = rank == 0 ? MPI_IN_PLACE : approx->word_hll.reg;
+    MPI_Reduce(send, approx->word_hll.reg, HLL_REGISTERS, MPI_UNSIGNED_CHAR, MPI_MAX, 0, MPI_COMM_WORLD);
+    send = rank == 0 ? MPI_IN_PLACE : approx->artist_hll.reg;
+    MPI_Reduce(send, approx->artist_hll.reg, HLL_REGISTERS, MPI_UNSIGNED_CHAR, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank != 0) wire_bytes_sent += 2 * HLL_REGISTERS;
+}
+
+// Largura para o printf alinhar s em width colunas: o printf conta bytes, e
+// cada caractere UTF-8 de vários bytes ocupa uma coluna só
+static int pad_width(const char *s, int width) {
+    for (; *s; s++) {
+        if (((unsigned char)*s & 0xC0) == 0x80) width++;
+    }
+    return width;
+}
+
+// --- Snapshot para reanálise incremental ---
+
+// Soma nas tabelas as contagens de um snapshot (pares de blocos até o fim de data)
+void merge_snapshot(const unsigned char *data, size_t size, WordTable *words, ArtistTable *artists) {
+    size_t offset = 0;
+    while (offset < size) {
+        offset += decode_merge_tables(data + offset, size - offset, words, artists, 0);
+    }
+}
+
+// Operação coletiva: grava as tabelas de quem tem owns != 0 (chaves disjuntas
+// entre esses ranks) com os totais de palavras e linhas de todos os ranks.
+// Retorna o tempo gasto.
+double save_snapshot(const char *path, const WordTable *words, const ArtistTable *artists, int owns,
+                     const Counters *counters, MPI_Offset processed, uint64_t fingerprint, int last_byte,
+                     int rank) {
+    double t0 = MPI_Wtime();
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.processed = (uint64_t)processed;
+    header.fingerprint = fingerprint;
+    header.last_byte = (uint64_t)last_byte;
+    unsigned long long local[2] = { (unsigned long long)counters->tokens, (unsigned long long)counters->lines };
+    unsigned long long total[2] = { 0, 0 };
+    MPI_Reduce(local, total, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    header.tokens = total[0];
+    header.lines = total[1];
+
+    ByteBuf buf;
+    bytebuf_init(&buf);
+    if (owns) {
+        KeyCountRef *wrefs = table_refs(words, NULL, words->count);
+        KeyCountRef *arefs = table_refs(artists, NULL, artists->count);
+        encode_tables(&buf, wrefs, words->count, arefs, artists->count);
+        free(wrefs);
+        free(arefs);
+    }
+    if (snapshot_write(path, &header, buf.data, buf.size) != 0 && rank == 0) {
+        fprintf(stderr, "Erro ao gravar o snapshot %s\n", path);
+    }
+    bytebuf_free(&buf);
+    return MPI_Wtime() - t0;
+}
+
 int main(int argc, char **argv) {
-    MPI_Init(&argc, &argv);
+    // As threads OpenMP não chamam MPI: apenas a thread principal se comunica
+    int thread_level;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_level);
     int rank, nprocs;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
     double start_time = MPI_Wtime();
     char *filename = "spotify_millsongdata_novo.csv";
+    ReduceMode reduce_mode = REDUCE_HASH;
+    int nthreads = 1;
+    TokenizerKind tokenizer = TOKENIZER_AUTO;
+    size_t block_size = 0;  // 0 = cada rank lê toda a sua faixa de uma vez
+    int dynamic = 0;        // blocos distribuídos sob demanda em vez de faixas fixas
+    int approx_size = 0;    // 0 = contagem exata; > 0 = contadores por resumo Space-Saving
+    const char *stats_json = NULL;
+    const char *snapshot_path = NULL;  // grava as tabelas mescladas ao final
+    int incremental = 0;               // parte do snapshot e processa só o que foi anexado
+
+    // Opções de linha de comando
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reduce") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "master") == 0) reduce_mode = REDUCE_MASTER;
+            else if (strcmp(mode, "tree") == 0) reduce_mode = REDUCE_TREE;
+            else if (strcmp(mode, "hash") == 0) reduce_mode = REDUCE_HASH;
+            else if (strcmp(mode, "topk") == 0) reduce_mode = REDUCE_TOPK;
+            else {
+                if (rank == 0) fprintf(stderr, "Modo de redução inválido: %s (use master, tree, hash ou topk)\n", mode);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+            if (nthreads < 1) {
+                if (rank == 0) fprintf(stderr, "Número de threads inválido: %s\n", argv[i]);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else if (strcmp(argv[i], "--tokenizer") == 0 && i + 1 < argc) {
+            const char *kind = argv[++i];
+            if (strcmp(kind, "auto") == 0) tokenizer = TOKENIZER_AUTO;
+            else if (strcmp(kind, "scalar") == 0) tokenizer = TOKENIZER_SCALAR;
+            else if (strcmp(kind, "sse4.2") == 0) tokenizer = TOKENIZER_SSE42;
+            else if (strcmp(kind, "avx2") == 0) tokenizer = TOKENIZER_AVX2;
+            else {
+                if (rank == 0) fprintf(stderr, "Tokenizador inválido: %s (use auto, scalar, sse4.2 ou avx2)\n", kind);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else if (strcmp(argv[i], "--schedule") == 0 && i + 1 < argc) {
+            const char *schedule = argv[++i];
+            if (strcmp(schedule, "static") == 0) dynamic = 0;
+            else if (strcmp(schedule, "dynamic") == 0) dynamic = 1;
+            else {
+                if (rank == 0) fprintf(stderr, "Escalonamento inválido: %s (use static ou dynamic)\n", schedule);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            if (block_size == 0) block_size = DEFAULT_BLOCK_SIZE;
+        } else if (strcmp(argv[i], "--block-size") == 0 && i + 1 < argc) {
+            // Em MB; aceita frações (ex.: 0.5)
+            double mb = atof(argv[++i]);
+            if (mb * 1024 * 1024 < MIN_BLOCK_SIZE || mb * 1024 * 1024 > MAX_BLOCK_SIZE) {
+                if (rank == 0) fprintf(stderr, "Tamanho de bloco inválido: %s MB\n", argv[i]);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            block_size = (size_t)(mb * 1024 * 1024);
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            filename = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (strcmp(argv[i], "--incremental") == 0) {
+            incremental = 1;
+        } else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+            stats_json = argv[++i];
+        } else if (strcmp(argv[i], "--compress") == 0) {
+            wire_compress = 1;
+        } else if (strcmp(argv[i], "--approx") == 0) {
+            if (approx_size == 0) approx_size = DEFAULT_APPROX_SIZE;
+        } else if (strcmp(argv[i], "--approx-size") == 0 && i + 1 < argc) {
+            approx_size = atoi(argv[++i]);
+            if (approx_size < TOP_N || approx_size > (1 << 24)) {
+                if (rank == 0) fprintf(stderr, "Tamanho de resumo inválido: %s (mínimo %d)\n", argv[i], TOP_N);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        } else {
+            if (rank == 0) fprintf(stderr, "Opção desconhecida: %s\n", argv[i]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
     
+    // No modo dinâmico os blocos já limitam a memória; --block-size define o tamanho deles
+    if (dynamic && block_size == 0) block_size = DEFAULT_DYNAMIC_BLOCK_SIZE;
+
+    // O snapshot guarda as tabelas exatas completas: o modo aproximado não as tem,
+    // e o top-K distribuído descarta o que não é candidato, então usa o shuffle por hash
+    if (incremental && snapshot_path == NULL) {
+        if (rank == 0) fprintf(stderr, "--incremental requer --snapshot ARQUIVO\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (snapshot_path != NULL && approx_size > 0) {
+        if (rank == 0) fprintf(stderr, "--snapshot não é suportado com --approx\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (snapshot_path != NULL && reduce_mode == REDUCE_TOPK) reduce_mode = REDUCE_HASH;
+
     // Variáveis para armazenar resultados
-    int word_capacity = INITIAL_CAPACITY, artist_capacity = INITIAL_CAPACITY;
-    int word_count = 0, artist_count = 0;
-    WordCount *words = malloc(word_capacity * sizeof(WordCount));
-    ArtistCount *artists = malloc(artist_capacity * sizeof(ArtistCount));
-    
-    // --- Lógica do Master ---
-    if (rank == 0) {
-        printf("=== Análise Paralela de Dados do Spotify com MPI ===\n\n");
-        printf("Número de processos: %d\n", nprocs);
-        printf("Arquivo: %s\n", filename);
-        
-        FILE *file = fopen(filename, "rb");
-        if (!file) {
-            fprintf(stderr, "Erro ao abrir o arquivo %s\n", filename);
+    WordTable words;
+    ArtistTable artists;
+    count_table_init(&words);
+    count_table_init(&artists);
+    ApproxCounts approx;
+    Counters counters = { &words, &artists, NULL, 0, 0 };
+    if (approx_size > 0) {
+        approx_init(&approx, approx_size);
+        counters.approx = &approx;
+    }
+
+    // Corpus binário (tratamento_csv/converter_csv): cada rank mapeia o arquivo
+    // com mmap e percorre só as suas músicas. Caso contrário, CSV via MPI-IO:
+    // todos os ranks abrem o arquivo e leem somente a sua faixa de bytes
+    Corpus corpus;
+    int use_corpus = corpus_is_file(filename);
+    MPI_File fh = MPI_FILE_NULL;
+    MPI_Offset file_size;
+    if (use_corpus && snapshot_path != NULL) {
+        if (rank == 0) fprintf(stderr, "--snapshot só é suportado com a entrada em CSV\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (use_corpus) {
+        // Mapeamento privado e gravável: o tokenizador converte as letras no lugar
+        if (corpus_open(&corpus, filename, 1) != 0) {
+            fprintf(stderr, "Rank %d: corpus binário inválido ou ilegível: %s\n", rank, filename);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        file_size = (MPI_Offset)corpus.size;
+    } else {
+        if (MPI_File_open(MPI_COMM_WORLD, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+            if (rank == 0) fprintf(stderr, "Erro ao abrir o arquivo %s\n", filename);
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        MPI_File_get_size(fh, &file_size);
+    }
 
-        // Obter tamanho do arquivo
-        fseek(file, 0, SEEK_END);
-        long file_size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        
-        printf("Tamanho do arquivo: %.2f MB\n\n", file_size / (1024.0 * 1024.0));
-        
-        // Ler todo o arquivo
-        char *file_content = malloc(file_size + 1);
-        size_t bytes_read = fread(file_content, 1, file_size, file);
-        file_content[bytes_read] = '\0';
-        fclose(file);
-        
-        // Pular cabeçalho
-        char *data_start = strchr(file_content, '\n');
-        if (data_start) data_start++;
-        else data_start = file_content;
-        
-        size_t data_size = bytes_read - (data_start - file_content);
-        
-        // Dividir o trabalho entre os processos
-        size_t chunk_size = data_size / nprocs;
-        
-        // Enviar chunks para os slaves
-        for (int i = 1; i < nprocs; i++) {
-            size_t start_pos = i * chunk_size;
-            size_t end_pos = (i == nprocs - 1) ? data_size : (i + 1) * chunk_size;
-            
-            // Ajustar para não cortar no meio de uma linha
-            if (end_pos < data_size) {
-                while (end_pos < data_size && data_start[end_pos] != '\n') {
-                    end_pos++;
-                }
-                if (end_pos < data_size) end_pos++;
+    // Reanálise incremental: o rank 0 carrega o snapshot e confere se o início do
+    // arquivo é o mesmo que foi contabilizado; nesse caso só [first, file_size) é lido
+    MPI_Offset first = 0;
+    uint64_t fingerprint = 0;           // do arquivo atual, para o próximo snapshot
+    int last_byte = SNAPSHOT_NO_BYTE;
+    SnapshotHeader previous;
+    unsigned char *previous_data = NULL;
+    int snapshot_status = 0;            // 1 = carregado, 2 = inexistente, 3 = incompatível, 4 = sem '\n' final
+    if (snapshot_path != NULL && rank == 0) {
+        fingerprint = snapshot_fingerprint(fh, file_size);
+        last_byte = snapshot_last_byte(fh, file_size);
+        if (incremental) {
+            previous_data = snapshot_read(snapshot_path, &previous);
+            if (previous_data == NULL) {
+                snapshot_status = 2;
+            } else if ((MPI_Offset)previous.processed > file_size ||
+                       snapshot_fingerprint(fh, (MPI_Offset)previous.processed) != previous.fingerprint) {
+                snapshot_status = 3;
+                free(previous_data);
+                previous_data = NULL;
+            } else if (previous.processed > 0 &&
+                       (previous.last_byte != '\n' ||
+                        snapshot_last_byte(fh, (MPI_Offset)previous.processed) != '\n')) {
+                // processed não é fim de registro: a primeira música nova seria cortada
+                snapshot_status = 4;
+                free(previous_data);
+                previous_data = NULL;
+            } else {
+                snapshot_status = 1;
+                first = (MPI_Offset)previous.processed;
             }
-            
-            size_t actual_size = end_pos - start_pos;
-            
-            MPI_Send(&actual_size, 1, MPI_UNSIGNED_LONG, i, 0, MPI_COMM_WORLD);
-            MPI_Send(data_start + start_pos, actual_size, MPI_CHAR, i, 1, MPI_COMM_WORLD);
         }
-        
-        // Processar o chunk do master
-        size_t master_size = (nprocs > 1) ? chunk_size : data_size;
-        if (nprocs > 1 && master_size < data_size) {
-            while (master_size < data_size && data_start[master_size] != '\n') {
-                master_size++;
-            }
-            if (master_size < data_size) master_size++;
+    }
+    MPI_Bcast(&first, 1, MPI_OFFSET, 0, MPI_COMM_WORLD);
+
+    tokenizer = tokenizer_select(tokenizer);
+
+    if (rank == 0) {
+        printf("=== Análise Paralela de Dados do Spotify com MPI ===\n\n");
+        printf("Número de processos: %d\n", nprocs);
+        printf("Threads por processo: %d\n", nthreads);
+        printf("Tokenizador: %s\n", tokenizer_name(tokenizer));
+        if (approx_size > 0) printf("Redução: resumos aproximados (Space-Saving com %d contadores + HyperLogLog)\n", approx_size);
+        else printf("Redução: %s\n", reduce_mode == REDUCE_MASTER ? "master" :
+                                 reduce_mode == REDUCE_TREE ? "árvore" :
+                                 reduce_mode == REDUCE_HASH ? "shuffle por hash" : "top-K distribuído");
+        printf("Arquivo: %s\n", filename);
+        printf("Tamanho do arquivo: %.2f MB\n", file_size / (1024.0 * 1024.0));
+        if (use_corpus) printf("Formato: corpus binário colunar (%llu músicas)\n", (unsigned long long)corpus.num_rows);
+        else if (dynamic) printf("Escalonamento dinâmico: blocos de %.2f MB sob demanda\n", block_size / (1024.0 * 1024.0));
+        else if (block_size > 0) printf("Leitura em streaming: blocos de %.2f MB\n", block_size / (1024.0 * 1024.0));
+        if (snapshot_status == 1) {
+            printf("Reanálise incremental: %.2f MB já contabilizados no snapshot, %.2f MB novos\n",
+                   first / (1024.0 * 1024.0), (file_size - first) / (1024.0 * 1024.0));
+        } else if (snapshot_status == 2) {
+            printf("Snapshot %s não encontrado: análise completa\n", snapshot_path);
+        } else if (snapshot_status == 3) {
+            printf("Snapshot %s não corresponde ao arquivo (reescrito ou truncado): análise completa\n", snapshot_path);
+        } else if (snapshot_status == 4) {
+            printf("Snapshot %s termina no meio de uma música (arquivo sem '\\n' final): análise completa\n", snapshot_path);
         }
-        
+        printf("\n");
         printf("Processando dados em paralelo...\n");
-        process_chunk(data_start, master_size, &words, &word_count, &word_capacity, 
-                     &artists, &artist_count, &artist_capacity);
-        
-        free(file_content);
-        
-        // Receber e agregar resultados dos slaves
-        for (int i = 1; i < nprocs; i++) {
-            MPI_Status status;
-            int recv_word_count, recv_artist_count;
-            
-            // Receber palavras
-            MPI_Recv(&recv_word_count, 1, MPI_INT, i, 2, MPI_COMM_WORLD, &status);
-            if (recv_word_count > 0) {
-                WordCount *recv_words = malloc(recv_word_count * sizeof(WordCount));
-                MPI_Recv(recv_words, recv_word_count * sizeof(WordCount), MPI_BYTE, i, 3, 
-                        MPI_COMM_WORLD, &status);
-                
-                // Mesclar palavras
-                for (int j = 0; j < recv_word_count; j++) {
-                    int found = 0;
-                    for (int k = 0; k < word_count; k++) {
-                        if (strcmp(words[k].word, recv_words[j].word) == 0) {
-                            words[k].count += recv_words[j].count;
-                            found = 1;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        if (word_count >= word_capacity) {
-                            word_capacity *= 2;
-                            words = realloc(words, word_capacity * sizeof(WordCount));
-                        }
-                        words[word_count++] = recv_words[j];
-                    }
-                }
-                free(recv_words);
-            }
-            
-            // Receber artistas
-            MPI_Recv(&recv_artist_count, 1, MPI_INT, i, 4, MPI_COMM_WORLD, &status);
-            if (recv_artist_count > 0) {
-                ArtistCount *recv_artists = malloc(recv_artist_count * sizeof(ArtistCount));
-                MPI_Recv(recv_artists, recv_artist_count * sizeof(ArtistCount), MPI_BYTE, i, 5, 
-                        MPI_COMM_WORLD, &status);
-                
-                // Mesclar artistas
-                for (int j = 0; j < recv_artist_count; j++) {
-                    int found = 0;
-                    for (int k = 0; k < artist_count; k++) {
-                        if (strcmp(artists[k].artist, recv_artists[j].artist) == 0) {
-                            artists[k].count += recv_artists[j].count;
-                            found = 1;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        if (artist_count >= artist_capacity) {
-                            artist_capacity *= 2;
-                            artists = realloc(artists, artist_capacity * sizeof(ArtistCount));
-                        }
-                        artists[artist_count++] = recv_artists[j];
-                    }
-                }
-                free(recv_artists);
+    }
+
+    if (use_corpus) {
+        // Sem leitura explícita: as páginas são carregadas sob demanda pelo mmap
+        process_corpus(&corpus, rank, nprocs, &counters, nthreads);
+        corpus_close(&corpus);
+    } else if (dynamic) {
+        process_dynamic(fh, file_size, first, rank, nprocs, block_size, &counters, nthreads);
+        MPI_File_close(&fh);
+    } else if (block_size > 0) {
+        // Streaming em blocos de tamanho fixo, com leitura sobreposta ao processamento
+        process_stream(fh, file_size, first, rank, nprocs, block_size, &counters, nthreads);
+        MPI_File_close(&fh);
+    } else {
+        size_t chunk_size;
+        char *chunk;
+        double t0 = MPI_Wtime();
+        char *buffer = read_rank_records(fh, file_size, first, rank, nprocs, &chunk, &chunk_size);
+        MPI_File_close(&fh);
+        rank_stats.time[PHASE_READ] += MPI_Wtime() - t0;
+
+        // Processar o chunk
+        process_chunk_threaded(chunk, chunk_size, &counters, nthreads);
+        free(buffer);
+    }
+    
+    rank_stats.lines = (unsigned long long)counters.lines;
+    rank_stats.tokens = (unsigned long long)counters.tokens;
+    rank_stats.unique_words = approx_size > 0 ? (unsigned long long)(hll_estimate(&approx.word_hll) + 0.5)
+                                              : (unsigned long long)words.count;
+
+    // O rank 0 soma as contagens do snapshot às do trecho novo antes da redução
+    if (previous_data != NULL) {
+        double t0 = MPI_Wtime();
+        merge_snapshot(previous_data, previous.data_size, &words, &artists);
+        counters.tokens += (long long)previous.tokens;
+        counters.lines += (long long)previous.lines;
+        free(previous_data);
+        rank_stats.time[PHASE_MERGE] += MPI_Wtime() - t0;
+    }
+
+    // Agregar os resultados de todos os ranks
+    double reduce_start = MPI_Wtime();
+    double snapshot_time = 0.0;
+    long long unique_words = 0, unique_artists = 0;
+    if (approx_size > 0) reduce_approx(&approx, rank, nprocs);
+    else switch (reduce_mode) {
+        case REDUCE_MASTER:
+            reduce_master(&words, &artists, rank, nprocs);
+            break;
+        case REDUCE_TREE:
+            reduce_tree(&words, &artists, rank, nprocs);
+            break;
+        case REDUCE_HASH:
+            shuffle_by_owner(&words, &artists, rank, nprocs);
+            // Após o shuffle as fatias são disjuntas: cada rank grava a sua no snapshot
+            if (snapshot_path != NULL) {
+                snapshot_time = save_snapshot(snapshot_path, &words, &artists, 1, &counters,
+                                              file_size, fingerprint, last_byte, rank);
             }
+            reduce_hash_candidates(&words, &artists, rank, nprocs, &unique_words, &unique_artists);
+            break;
+        case REDUCE_TOPK:
+            reduce_topk(&words, &artists, rank, nprocs, &unique_words, &unique_artists);
+            break;
+    }
+    if (approx_size > 0) {
+        unique_words = (long long)(hll_estimate(&approx.word_hll) + 0.5);
+        unique_artists = (long long)(hll_estimate(&approx.artist_hll) + 0.5);
+    } else if (reduce_mode == REDUCE_MASTER || reduce_mode == REDUCE_TREE) {
+        unique_words = words.count;
+        unique_artists = artists.count;
+        // As tabelas completas estão no rank 0
+        if (snapshot_path != NULL) {
+            snapshot_time = save_snapshot(snapshot_path, &words, &artists, rank == 0, &counters,
+                                          file_size, fingerprint, last_byte, rank);
         }
+    }
+    unsigned long long traffic[3] = { wire_bytes_sent, raw_bytes_equiv, (unsigned long long)counters.tokens };
+    unsigned long long total_traffic[3] = { 0, 0, 0 };
+    MPI_Reduce(traffic, total_traffic, 3, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    rank_stats.time[PHASE_REDUCE] += MPI_Wtime() - reduce_start - snapshot_time;
+    rank_stats.time[PHASE_OUTPUT] += snapshot_time;
 
+    // --- Lógica do Master ---
+    if (rank == 0) {
         double end_time = MPI_Wtime();
         
-        // Ordenar e exibir resultados
-        qsort(words, word_count, sizeof(WordCount), compare_word_count);
-        qsort(artists, artist_count, sizeof(ArtistCount), compare_artist_count);
+        // Selecionar e exibir os top-N (sem ordenar o vocabulário inteiro)
+        int top_words[TOP_N], top_artists[TOP_N];
+        int n_words = select_top_k(&words, TOP_N, top_words);
+        int n_artists = select_top_k(&artists, TOP_N, top_artists);
 
         printf("\n================================================\n");
         printf("              RESULTADOS DA ANÁLISE\n");
         printf("================================================\n\n");
         
-        printf("--- Top %d Artistas com Mais Músicas ---\n", TOP_N);
-        for(int i = 0; i < TOP_N && i < artist_count; i++) {
-            printf("%3d. %-40s %6d músicas\n", i + 1, artists[i].artist, artists[i].count);
-        }
+        if (approx_size > 0) {
+            // Estimativas: a contagem real está em [count - error, count]
+            n_artists = ss_top(&approx.artists, TOP_N, top_artists);
+            n_words = ss_top(&approx.words, TOP_N, top_words);
 
-        printf("\n--- Top %d Palavras Mais Frequentes ---\n", TOP_N);
-        for(int i = 0; i < TOP_N && i < word_count; i++) {
-            printf("%3d. %-30s %10d ocorrências\n", i + 1, words[i].word, words[i].count);
+            printf("--- Top %d Artistas com Mais Músicas (aprox.) ---\n", TOP_N);
+            for(int i = 0; i < n_artists; i++) {
+                const SSCounter *a = &approx.artists.counters[top_artists[i]];
+                printf("%3d. %-*s %6lld músicas (±%lld)\n", i + 1, pad_width(a->key, 40), a->key, a->count, a->error);
+            }
+
+            printf("\n--- Top %d Palavras Mais Frequentes (aprox.) ---\n", TOP_N);
+            for(int i = 0; i < n_words; i++) {
+                const SSCounter *w = &approx.words.counters[top_words[i]];
+                printf("%3d. %-*s %10lld ocorrências (±%lld)\n", i + 1, pad_width(w->key, 30), w->key, w->count, w->error);
+            }
+        } else {
+            printf("--- Top %d Artistas com Mais Músicas ---\n", TOP_N);
+            for(int i = 0; i < n_artists; i++) {
+                const KeyCount *a = &artists.items[top_artists[i]];
+                const char *name = artists.arena.data + a->key;
+                printf("%3d. %-*s %6d músicas\n", i + 1, pad_width(name, 40), name, a->count);
+            }
+
+            printf("\n--- Top %d Palavras Mais Frequentes ---\n", TOP_N);
+            for(int i = 0; i < n_words; i++) {
+                const KeyCount *w = &words.items[top_words[i]];
+                const char *word = words.arena.data + w->key;
+                printf("%3d. %-*s %10d ocorrências\n", i + 1, pad_width(word, 30), word, w->count);
+            }
         }
         
         printf("\n================================================\n");
         printf("Estatísticas:\n");
-        printf("  - Total de artistas únicos: %d\n", artist_count);
-        printf("  - Total de palavras únicas: %d\n", word_count);
+        const char *estimate = approx_size > 0 ? " (aprox.)" : "";
+        printf("  - Total de palavras processadas: %llu\n", total_traffic[2]);
+        printf("  - Total de artistas únicos: %lld%s\n", unique_artists, estimate);
+        printf("  - Total de palavras únicas: %lld%s\n", unique_words, estimate);
+        if (approx_size > 0) {
+            printf("  - Volume trocado entre ranks: %.2f MB (resumos)\n", total_traffic[0] / (1024.0 * 1024.0));
+        } else {
+            printf("  - Volume trocado entre ranks: %.2f MB%s (formato antigo: %.2f MB)\n",
+                   total_traffic[0] / (1024.0 * 1024.0), wire_compress ? " com LZ" : "",
+                   total_traffic[1] / (1024.0 * 1024.0));
+        }
+        if (snapshot_path != NULL) printf("  - Snapshot salvo em: %s\n", snapshot_path);
         printf("  - Tempo de execução: %.3f segundos\n", end_time - start_time);
         printf("================================================\n");
-        
-        free(words);
-        free(artists);
-
-    } 
-    // --- Lógica do Slave ---
-    else {
-        MPI_Status status;
-        size_t chunk_size;
-
-        MPI_Recv(&chunk_size, 1, MPI_UNSIGNED_LONG, 0, 0, MPI_COMM_WORLD, &status);
-        char *chunk = malloc(chunk_size + 1);
-        MPI_Recv(chunk, chunk_size, MPI_CHAR, 0, 1, MPI_COMM_WORLD, &status);
-        chunk[chunk_size] = '\0';
-        
-        // Processar o chunk
-        process_chunk(chunk, chunk_size, &words, &word_count, &word_capacity, 
-                     &artists, &artist_count, &artist_capacity);
-        
-        free(chunk);
-        
-        // Enviar resultados de volta para o master
-        MPI_Send(&word_count, 1, MPI_INT, 0, 2, MPI_COMM_WORLD);
-        if (word_count > 0) {
-            MPI_Send(words, word_count * sizeof(WordCount), MPI_BYTE, 0, 3, MPI_COMM_WORLD);
-        }
-        MPI_Send(&artist_count, 1, MPI_INT, 0, 4, MPI_COMM_WORLD);
-        if (artist_count > 0) {
-            MPI_Send(artists, artist_count * sizeof(ArtistCount), MPI_BYTE, 0, 5, MPI_COMM_WORLD);
-        }
-        
-        free(words);
-        free(artists);
+        rank_stats.time[PHASE_OUTPUT] += MPI_Wtime() - end_time;
     }
+    rank_stats.total = MPI_Wtime() - start_time;
+    stats_report(rank, nprocs, stats_json);
+
+    count_table_free(&words);
+    count_table_free(&artists);
+    if (approx_size > 0) approx_free(&approx);
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
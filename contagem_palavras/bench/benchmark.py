@@ -0,0 +1,169 @@
+"""Mede o spotify_analyzer variando o número de processos e o tamanho da entrada.
+
+Dois tipos de varredura:
+  - escalabilidade forte: entrada fixa (--tamanhos), -np variando;
+    eficiência = T(np_base) * np_base / (T(np) * np)
+  - escalabilidade fraca: --por-rank MB para cada processo (entrada cresce com -np);
+    eficiência = T(np_base) / T(np)
+
+Cada configuração roda --repeticoes vezes e a menor duração é usada. O
+resultado vai para a tela e, opcionalmente, para JSON (--json) e CSV (--csv),
+com vazão em MB/s e palavras/s, para comparar execuções entre versões.
+
+Exemplo:
+    python3 bench/benchmark.py --np 1,2,4 --tamanhos 16,64 --por-rank 16 --json resultados.json
+Valores que começam com "--" devem ser passados com "=", por exemplo
+--opcoes="--reduce tree" ou --mpirun-args=--oversubscribe.
+"""
+
+import argparse
+import csv
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+
+DIR_BENCH = os.path.dirname(os.path.abspath(__file__))
+ANALISADOR = os.path.join(DIR_BENCH, '..', 'spotify_analyzer')
+GERADOR = os.path.join(DIR_BENCH, 'gerar_corpus.py')
+
+RE_TEMPO = re.compile(r'Tempo de execução: ([0-9.]+)')
+RE_PALAVRAS = re.compile(r'Total de palavras processadas: ([0-9]+)')
+
+
+def lista_numeros(texto, tipo):
+    return [tipo(v) for v in texto.split(',') if v.strip()]
+
+
+def preparar_corpus(dir_trabalho, tamanho_mb, args):
+    """Gera (ou reaproveita) o corpus sintético de tamanho_mb MB."""
+    nome = 'corpus_%gmb_v%d_z%g_s%d.csv' % (tamanho_mb, args.vocabulario, args.zipf, args.semente)
+    caminho = os.path.join(dir_trabalho, nome)
+    if not os.path.exists(caminho):
+        print(f'Gerando {caminho}...', file=sys.stderr)
+        subprocess.run([sys.executable, GERADOR, '--tamanho', str(tamanho_mb),
+                        '--vocabulario', str(args.vocabulario), '--zipf', str(args.zipf),
+                        '--semente', str(args.semente), '--saida', caminho + '.tmp'], check=True)
+        os.replace(caminho + '.tmp', caminho)
+    return caminho
+
+
+def executar(np_, corpus, args):
+    """Roda o analisador e retorna (menor tempo, palavras processadas)."""
+    cmd = shlex.split(args.mpirun) + ['-np', str(np_)] + shlex.split(args.mpirun_args)
+    cmd += [args.analisador, '--input', corpus, '--threads', str(args.threads)] + shlex.split(args.opcoes)
+    env = dict(os.environ, OMP_NUM_THREADS=str(args.threads))
+
+    melhor, palavras = None, None
+    for _ in range(args.repeticoes):
+        proc = subprocess.run(cmd, capture_output=True, text=True, env=env)
+        tempo = RE_TEMPO.search(proc.stdout)
+        total = RE_PALAVRAS.search(proc.stdout)
+        if proc.returncode != 0 or tempo is None or total is None:
+            print(f"Erro ao executar: {' '.join(cmd)}", file=sys.stderr)
+            print(proc.stdout + proc.stderr, file=sys.stderr)
+            sys.exit(1)
+        t = float(tempo.group(1))
+        melhor = t if melhor is None else min(melhor, t)
+        palavras = int(total.group(1))
+    return melhor, palavras
+
+
+def medir(modo, np_, corpus, args):
+    tamanho_mb = os.path.getsize(corpus) / (1024 * 1024)
+    tempo, palavras = executar(np_, corpus, args)
+    resultado = {
+        'modo': modo,
+        'np': np_,
+        'threads': args.threads,
+        'tamanho_mb': round(tamanho_mb, 3),
+        'tempo_s': tempo,
+        'mb_s': round(tamanho_mb / tempo, 3) if tempo > 0 else None,
+        'palavras': palavras,
+        'palavras_s': round(palavras / tempo) if tempo > 0 else None,
+        'eficiencia': None,
+    }
+    print(f"{modo:5s} np={np_:<3d} {tamanho_mb:9.2f} MB {tempo:8.3f} s "
+          f"{resultado['mb_s'] or 0:9.2f} MB/s {resultado['palavras_s'] or 0:12d} palavras/s", file=sys.stderr)
+    return resultado
+
+
+def calcular_eficiencia(resultados):
+    """Preenche a eficiência relativa ao menor -np de cada série."""
+    series = {}
+    for r in resultados:
+        chave = (r['modo'], r['tamanho_mb']) if r['modo'] == 'forte' else (r['modo'],)
+        series.setdefault(chave, []).append(r)
+    for serie in series.values():
+        base = min(serie, key=lambda r: r['np'])
+        for r in serie:
+            if r['tempo_s'] <= 0:
+                continue
+            if r['modo'] == 'forte':
+                r['eficiencia'] = round(base['tempo_s'] * base['np'] / (r['tempo_s'] * r['np']), 3)
+            else:
+                r['eficiencia'] = round(base['tempo_s'] / r['tempo_s'], 3)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark de escalabilidade do spotify_analyzer')
+    parser.add_argument('--np', default='1,2,4', help='lista de números de processos (padrão: 1,2,4)')
+    parser.add_argument('--tamanhos', default='16', help='tamanhos da entrada em MB para escalabilidade forte')
+    parser.add_argument('--por-rank', type=float, default=0,
+                        help='MB por processo para escalabilidade fraca (0 = não medir)')
+    parser.add_argument('--repeticoes', type=int, default=3, help='execuções por configuração (padrão: 3)')
+    parser.add_argument('--threads', type=int, default=1, help='threads por processo (padrão: 1)')
+    parser.add_argument('--opcoes', default='', help='opções extras do analisador (ex.: "--reduce tree")')
+    parser.add_argument('--mpirun', default='mpirun', help='comando do MPI (padrão: mpirun)')
+    parser.add_argument('--mpirun-args', default='', help='argumentos extras do mpirun (ex.: "--oversubscribe")')
+    parser.add_argument('--analisador', default=ANALISADOR, help='executável a medir')
+    parser.add_argument('--vocabulario', type=int, default=30000, help='palavras distintas do corpus')
+    parser.add_argument('--zipf', type=float, default=1.1, help='expoente de Zipf do corpus')
+    parser.add_argument('--semente', type=int, default=42, help='semente do corpus')
+    parser.add_argument('--dir-trabalho', default=os.path.join(DIR_BENCH, 'corpus'),
+                        help='onde guardar os corpus gerados')
+    parser.add_argument('--json', help='grava os resultados em JSON')
+    parser.add_argument('--csv', help='grava os resultados em CSV')
+    args = parser.parse_args()
+
+    procs = lista_numeros(args.np, int)
+    tamanhos = lista_numeros(args.tamanhos, float)
+    if not procs or min(procs) < 1 or args.repeticoes < 1:
+        parser.error('--np e --repeticoes devem ser positivos')
+    if not os.path.exists(args.analisador):
+        parser.error(f"executável '{args.analisador}' não encontrado (rode make)")
+    os.makedirs(args.dir_trabalho, exist_ok=True)
+
+    resultados = []
+    for tamanho in tamanhos:
+        corpus = preparar_corpus(args.dir_trabalho, tamanho, args)
+        for np_ in procs:
+            resultados.append(medir('forte', np_, corpus, args))
+    if args.por_rank > 0:
+        for np_ in procs:
+            corpus = preparar_corpus(args.dir_trabalho, args.por_rank * np_, args)
+            resultados.append(medir('fraca', np_, corpus, args))
+    calcular_eficiencia(resultados)
+
+    print(f"\n{'modo':5s} {'np':>3s} {'MB':>9s} {'tempo (s)':>10s} {'MB/s':>9s} {'palavras/s':>12s} {'efic.':>6s}")
+    for r in resultados:
+        efic = '%.2f' % r['eficiencia'] if r['eficiencia'] is not None else '-'
+        print(f"{r['modo']:5s} {r['np']:3d} {r['tamanho_mb']:9.2f} {r['tempo_s']:10.3f} "
+              f"{r['mb_s'] or 0:9.2f} {r['palavras_s'] or 0:12d} {efic:>6s}")
+
+    if args.json:
+        with open(args.json, 'w', encoding='utf-8') as f:
+            json.dump({'opcoes': args.opcoes, 'resultados': resultados}, f, indent=2, ensure_ascii=False)
+        print(f"\nResultados salvos em: {args.json}")
+    if args.csv:
+        with open(args.csv, 'w', newline='', encoding='utf-8') as f:
+            escritor = csv.DictWriter(f, fieldnames=list(resultados[0].keys()))
+            escritor.writeheader()
+            escritor.writerows(resultados)
+        print(f"Resultados salvos em: {args.csv}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,259 @@
+// Microbenchmark da separação de campos CSV: compara ../comum/csv.h (visões
+// para o próprio registro, aspas desfeitas no lugar) com os dois parsers que os
+// programas usavam antes: o do app.c (cópia do registro para um buffer de linha
+// + extract_csv_field) e o do sentiment_mpi.c (um malloc por campo).
+//
+// As alocações são contadas com -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+// (veja a regra bench_csv do makefile). Cada parser lê as colunas artist e text
+// de todas as músicas do arquivo; os registros são separados antes, fora da
+// medição, e cada repetição recebe uma cópia nova do arquivo.
+//
+// Uso: campos_csv arquivo.csv [repetições]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "csv.h"
+
+#define MAX_LINE_LEN 20000
+#define MAXFIELDS 256
+
+// --- Contagem de alocações (--wrap) ---
+
+static size_t allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    allocations++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+// --- Parser anterior do app.c ---
+
+static char *extract_csv_field(char **ptr) {
+    if (*ptr == NULL || **ptr == '\0') return NULL;
+    char *start = *ptr;
+    char *field_start = start;
+    if (*start == '"') {
+        field_start = ++start;
+        while (*start) {
+            if (*start == '"') {
+                if (*(start + 1) == '"') {
+                    start += 2;
+                } else {
+                    *start = '\0';
+                    start++;
+                    if (*start == ',') start++;
+                    *ptr = start;
+                    return field_start;
+                }
+            } else {
+                start++;
+            }
+        }
+    } else {
+        while (*start && *start != ',') start++;
+        if (*start == ',') {
+            *start = '\0';
+            *ptr = start + 1;
+        } else {
+            *ptr = start;
+        }
+        return field_start;
+    }
+    *ptr = start;
+    return field_start;
+}
+
+static size_t parse_app(char *record, size_t len) {
+    if (len == 0 || len >= MAX_LINE_LEN) return 0;
+    char line[MAX_LINE_LEN];
+    memcpy(line, record, len);
+    line[len] = '\0';
+    char *ptr = line;
+    char *artist = extract_csv_field(&ptr);
+    extract_csv_field(&ptr);
+    extract_csv_field(&ptr);
+    char *text = extract_csv_field(&ptr);
+    return (artist ? strlen(artist) : 0) + (text ? strlen(text) : 0);
+}
+
+// --- Parser anterior do sentiment_mpi.c ---
+
+static int parse_csv_line(const char *line, char **fields, int maxfields) {
+    const char *p = line;
+    int field = 0;
+    while (*p && field < maxfields) {
+        if (*p == '"') {
+            p++;
+            char *buf = malloc(strlen(p) + 1);
+            if (!buf) return -1;
+            int idx = 0;
+            while (*p) {
+                if (*p == '"') {
+                    if (*(p+1) == '"') {
+                        buf[idx++] = '"';
+                        p += 2;
+                    } else {
+                        p++;
+                        break;
+                    }
+                } else {
+                    buf[idx++] = *p;
+                    p++;
+                }
+            }
+            buf[idx] = '\0';
+            fields[field++] = buf;
+            while (*p && *p != ',') p++;
+            if (*p == ',') p++;
+        } else {
+            const char *start = p;
+            const char *comma = strchr(p, ',');
+            size_t len = comma ? (size_t)(comma - start) : strlen(start);
+            char *buf = malloc(len + 1);
+            if (!buf) return -1;
+            memcpy(buf, start, len);
+            buf[len] = '\0';
+            fields[field++] = buf;
+            if (comma) p = comma + 1;
+            else p += len;
+        }
+    }
+    return field;
+}
+
+static size_t parse_sentiment(char *record, size_t len) {
+    record[len] = '\0';
+    char *fields[MAXFIELDS];
+    int nf = parse_csv_line(record, fields, MAXFIELDS);
+    size_t bytes = (nf > 0 ? strlen(fields[0]) : 0) + (nf > 3 ? strlen(fields[3]) : 0);
+    for (int i = 0; i < nf; ++i) free(fields[i]);
+    return bytes;
+}
+
+// --- comum/csv.h ---
+
+static size_t parse_views(char *record, size_t len) {
+    CsvField fields[4];
+    int nf = csv_split(record, len, fields, 4);
+    size_t bytes = 0;
+    csv_field_unescape(&fields[0]);
+    bytes += fields[0].len;
+    if (nf == 4) {
+        csv_field_unescape(&fields[3]);
+        bytes += fields[3].len;
+    }
+    return bytes;
+}
+
+// --- Medição ---
+
+typedef size_t (*Parser)(char *record, size_t len);
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Inícios dos registros (um '\n' fora de aspas termina o registro); starts[n] = size
+static size_t *split_records(const char *data, size_t size, size_t *count) {
+    size_t capacity = 1024, n = 0;
+    size_t *starts = __real_malloc(capacity * sizeof(size_t));
+    int in_quotes = 0;
+    starts[n++] = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] == '"') in_quotes ^= 1;
+        else if (data[i] == '\n' && !in_quotes && i + 1 < size) {
+            if (n + 1 == capacity) {
+                capacity *= 2;
+                starts = __real_realloc(starts, capacity * sizeof(size_t));
+            }
+            starts[n++] = i + 1;
+        }
+    }
+    starts[n] = size;
+    *count = n;
+    return starts;
+}
+
+static void run(const char *name, Parser parse, const char *data, size_t size,
+                const size_t *starts, size_t count, int repetitions) {
+    char *copy = __real_malloc(size + 1);
+    double best = 0.0;
+    size_t bytes = 0, allocs = 0;
+    for (int r = 0; r < repetitions; r++) {
+        memcpy(copy, data, size);
+        copy[size] = '\0';
+        size_t before = allocations;
+        bytes = 0;
+        double t0 = now();
+        for (size_t i = 1; i < count; i++) {   // o registro 0 é o cabeçalho
+            size_t len = starts[i + 1] - starts[i];
+            char *record = copy + starts[i];
+            while (len && (record[len - 1] == '\n' || record[len - 1] == '\r')) len--;
+            bytes += parse(record, len);
+        }
+        double elapsed = now() - t0;
+        allocs = allocations - before;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    free(copy);
+    size_t rows = count > 0 ? count - 1 : 0;
+    printf("%-22s %9.3f ms %9.1f MB/s %12.0f músicas/s %10.2f alocações/música  (%zu bytes de campo)\n",
+           name, best * 1e3, size / best / (1024.0 * 1024.0), rows / best,
+           rows ? (double)allocs / rows : 0.0, bytes);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s arquivo.csv [repetições]\n", argv[0]);
+        return 1;
+    }
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+    if (repetitions < 1) repetitions = 1;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = __real_malloc(size + 1);
+    if (fread(data, 1, size, f) != size) {
+        fprintf(stderr, "Erro ao ler %s\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    size_t count;
+    size_t *starts = split_records(data, size, &count);
+    printf("%s: %.2f MB, %zu músicas, melhor de %d repetições\n",
+           argv[1], size / (1024.0 * 1024.0), count > 0 ? count - 1 : 0, repetitions);
+
+    run("app.c (anterior)", parse_app, data, size, starts, count, repetitions);
+    run("sentiment (anterior)", parse_sentiment, data, size, starts, count, repetitions);
+    run("comum/csv.h", parse_views, data, size, starts, count, repetitions);
+
+    free(starts);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,86 @@
+"""Gera um CSV sintético de letras no formato artist,song,link,text.
+
+As palavras seguem uma distribuição de Zipf (a palavra de posição r aparece
+com frequência proporcional a 1 / r^s), o que imita o vocabulário de letras
+reais: poucas palavras muito frequentes e uma cauda longa de palavras raras.
+
+Exemplo:
+    python3 gerar_corpus.py --tamanho 64 --vocabulario 50000 --zipf 1.1 --saida corpus.csv
+"""
+
+import argparse
+import random
+import string
+import sys
+from itertools import accumulate
+
+TAMANHO_LOTE = 100  # linhas geradas por chamada de random.choices
+
+
+def criar_vocabulario(n, rng):
+    """Cria n palavras distintas de 2 a 12 letras."""
+    palavras = set()
+    while len(palavras) < n:
+        tamanho = min(12, 2 + int(rng.expovariate(0.35)))
+        palavras.add(''.join(rng.choices(string.ascii_lowercase, k=tamanho)))
+    return sorted(palavras, key=lambda p: (len(p), p))
+
+
+def campo_csv(valor):
+    """Coloca o campo entre aspas quando necessário (como o pandas faz)."""
+    if ',' in valor or '"' in valor:
+        return '"' + valor.replace('"', '""') + '"'
+    return valor
+
+
+def gerar(saida, tamanho_bytes, vocabulario, zipf, artistas, palavras_por_musica, semente):
+    rng = random.Random(semente)
+    vocab = criar_vocabulario(vocabulario, rng)
+    pesos = list(accumulate(1.0 / (r ** zipf) for r in range(1, vocabulario + 1)))
+    nomes = ['Artist %d' % i for i in range(artistas)]
+    pesos_artistas = list(accumulate(1.0 / r for r in range(1, artistas + 1)))
+
+    saida.write('artist,song,link,text\n')
+    escritos = 0
+    musica = 0
+    while escritos < tamanho_bytes:
+        linhas = []
+        autores = rng.choices(nomes, cum_weights=pesos_artistas, k=TAMANHO_LOTE)
+        for autor in autores:
+            n = max(2, int(rng.gauss(palavras_por_musica, palavras_por_musica / 4)))
+            letra = ' '.join(rng.choices(vocab, cum_weights=pesos, k=n))
+            linhas.append(','.join([campo_csv(autor), 'Song %d' % musica,
+                                    '/a/%s/song-%d.html' % (autor.replace(' ', '+').lower(), musica),
+                                    '"' + letra + '"']))
+            musica += 1
+        bloco = '\n'.join(linhas) + '\n'
+        saida.write(bloco)
+        escritos += len(bloco.encode('utf-8'))
+    return musica
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Gera um corpus sintético de letras em CSV')
+    parser.add_argument('--tamanho', type=float, default=16, help='tamanho aproximado em MB (padrão: 16)')
+    parser.add_argument('--vocabulario', type=int, default=30000, help='palavras distintas (padrão: 30000)')
+    parser.add_argument('--zipf', type=float, default=1.1, help='expoente s da distribuição de Zipf (padrão: 1.1)')
+    parser.add_argument('--artistas', type=int, default=600, help='artistas distintos (padrão: 600)')
+    parser.add_argument('--palavras', type=int, default=220, help='palavras por música, em média (padrão: 220)')
+    parser.add_argument('--semente', type=int, default=42, help='semente do gerador aleatório (padrão: 42)')
+    parser.add_argument('--saida', default='-', help='arquivo de saída (padrão: saída padrão)')
+    args = parser.parse_args()
+
+    if args.vocabulario < 1 or args.artistas < 1 or args.tamanho <= 0:
+        parser.error('tamanho, vocabulário e artistas devem ser positivos')
+
+    tamanho_bytes = int(args.tamanho * 1024 * 1024)
+    if args.saida == '-':
+        gerar(sys.stdout, tamanho_bytes, args.vocabulario, args.zipf, args.artistas, args.palavras, args.semente)
+    else:
+        with open(args.saida, 'w', encoding='utf-8') as saida:
+            n = gerar(saida, tamanho_bytes, args.vocabulario, args.zipf, args.artistas, args.palavras, args.semente)
+        print(f"Corpus gerado: '{args.saida}' com {n} músicas.", file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
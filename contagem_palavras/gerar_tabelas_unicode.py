@@ -0,0 +1,98 @@
+"""Gera unicode_tables.h, as tabelas do tokenizador para caracteres não ASCII.
+
+Para cada ponto de código (U+0080 a U+10FFFF) a tabela guarda:
+  - a classe: delimitador (espaços, pontuação, símbolos e controles), letra
+    (categorias L*) ou outro caractere de palavra (marcas, dígitos, ...);
+  - a forma minúscula simples, quando ela tem o mesmo tamanho em UTF-8 (assim
+    a conversão é feita no próprio buffer; os raros casos que mudariam de
+    tamanho, como U+0130, ficam como estão).
+
+O apóstrofo tipográfico (U+2019) não é delimitador, como o ' do ASCII, para
+"don’t" continuar sendo uma palavra só.
+
+Busca em dois níveis: stage1[cp >> 7] escolhe um bloco de 128 entradas de
+stage2; cada entrada tem a classe nos 2 bits baixos e, acima deles, o índice
+em deltas (minúscula = cp + deltas[índice]). Blocos iguais são compartilhados.
+
+Uso (a partir de contagem_palavras/):
+    python3 gerar_tabelas_unicode.py > unicode_tables.h
+"""
+
+import sys
+import unicodedata
+
+BLOCK_BITS = 7
+BLOCK = 1 << BLOCK_BITS
+MAX_CP = 0x110000
+
+CLASS_OTHER, CLASS_DELIM, CLASS_ALPHA = 0, 1, 2
+NOT_DELIM = {0x2019}  # apóstrofo tipográfico
+DELIM_FORMAT = {0x200B, 0xFEFF}  # espaço de largura zero e BOM
+
+
+def classify(cp):
+    if cp in NOT_DELIM:
+        return CLASS_OTHER
+    cat = unicodedata.category(chr(cp))
+    if cat[0] == 'L':
+        return CLASS_ALPHA
+    if cat[0] in 'ZS' or cat == 'Cc' or (cat[0] == 'P' and cat != 'Pc') or cp in DELIM_FORMAT:
+        return CLASS_DELIM
+    return CLASS_OTHER
+
+
+def lower_delta(cp):
+    low = chr(cp).lower()
+    if len(low) != 1 or 0xD800 <= ord(low) <= 0xDFFF:
+        return 0
+    if len(low.encode('utf-8')) != len(chr(cp).encode('utf-8', 'surrogatepass')):
+        return 0
+    return ord(low) - cp
+
+
+def main():
+    deltas = [0]
+    delta_index = {0: 0}
+    blocks = {}
+    stage1 = []
+    stage2 = []
+    for base in range(0, MAX_CP, BLOCK):
+        entries = []
+        for cp in range(base, base + BLOCK):
+            if cp < 0x80 or 0xD800 <= cp <= 0xDFFF:
+                entries.append(CLASS_OTHER)  # ASCII usa as tabelas de bytes; surrogates são inválidos
+                continue
+            d = lower_delta(cp)
+            if d not in delta_index:
+                delta_index[d] = len(deltas)
+                deltas.append(d)
+            entries.append(classify(cp) | (delta_index[d] << 2))
+        key = tuple(entries)
+        if key not in blocks:
+            blocks[key] = len(blocks)
+            stage2.extend(entries)
+        stage1.append(blocks[key])
+
+    stage1_type = 'uint8_t' if len(blocks) <= 256 else 'uint16_t'
+    out = sys.stdout
+    out.write('// Gerado por gerar_tabelas_unicode.py (Unicode %s). Não editar.\n'
+              % unicodedata.unidata_version)
+    out.write('#ifndef UNICODE_TABLES_H\n#define UNICODE_TABLES_H\n\n#include <stdint.h>\n\n')
+    out.write('#define UNICODE_BLOCK_BITS %d\n' % BLOCK_BITS)
+    out.write('#define UNICODE_CLASS_DELIM %d\n#define UNICODE_CLASS_ALPHA %d\n\n'
+              % (CLASS_DELIM, CLASS_ALPHA))
+
+    def array(ctype, name, values, per_line):
+        out.write('static const %s %s[%d] = {\n' % (ctype, name, len(values)))
+        for i in range(0, len(values), per_line):
+            out.write('    ' + ', '.join(str(v) for v in values[i:i + per_line]) + ',\n')
+        out.write('};\n\n')
+
+    array(stage1_type, 'unicode_stage1', stage1, 24)
+    array('uint16_t', 'unicode_stage2', stage2, 16)
+    array('int32_t', 'unicode_deltas', deltas, 12)
+    out.write('#endif\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -13,11 +13,27 @@ if [ ! -f "./spotify_analyzer" ]; then
     echo ""
 fi
 
+# Uso: ./run_analysis.sh [processos] [threads por processo] [opções do analisador]
 NP=${1:-4}
+shift
+THREADS=1
+if [[ "$1" =~ ^[0-9]+$ ]]; then
+    THREADS=$1
+    shift
+fi
+
+# Com várias threads por processo, não prender cada rank a um único núcleo
+BIND_OPTS=""
+if [ "$THREADS" -gt 1 ]; then
+    BIND_OPTS="--bind-to none"
+fi
+export OMP_NUM_THREADS=$THREADS
+
+# Demais argumentos são repassados ao analisador (ex.: --reduce tree)
 
 OUTPUT_FILE="resultados_analise_$(date +%Y%m%d_%H%M%S).txt"
 
-mpirun -np $NP ./spotify_analyzer 2>&1 | tee "$OUTPUT_FILE"
+mpirun -np $NP $BIND_OPTS ./spotify_analyzer --threads $THREADS "$@" 2>&1 | tee "$OUTPUT_FILE"
 
 if [ ${PIPESTATUS[0]} -eq 0 ]; then
     echo ""
@@ -0,0 +1,305 @@
+#include "sketch.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *sketch_realloc(void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (p == NULL && size > 0) {
+        fprintf(stderr, "Erro: memória insuficiente no resumo (%zu bytes)\n", size);
+        abort();
+    }
+    return p;
+}
+
+// FNV-1a de 64 bits seguido do finalizador do MurmurHash3, para que os bits
+// altos (usados pelo HyperLogLog) também sejam bem distribuídos
+uint64_t sketch_hash(const char *key, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// --- Space-Saving ---
+
+void ss_init(SpaceSaving *ss, int capacity) {
+    size_t nslots = 16;
+    while (nslots < (size_t)capacity * 2) nslots <<= 1;
+    ss->counters = sketch_realloc(NULL, capacity * sizeof(SSCounter));
+    ss->heap = sketch_realloc(NULL, capacity * sizeof(int));
+    ss->slots = sketch_realloc(NULL, nslots * sizeof(int));
+    for (size_t i = 0; i < nslots; i++) ss->slots[i] = -1;
+    ss->mask = nslots - 1;
+    ss->capacity = capacity;
+    ss->size = 0;
+}
+
+void ss_free(SpaceSaving *ss) {
+    free(ss->counters);
+    free(ss->heap);
+    free(ss->slots);
+    ss->counters = NULL;
+    ss->heap = ss->slots = NULL;
+    ss->size = ss->capacity = 0;
+}
+
+static void heap_swap(SpaceSaving *ss, int a, int b) {
+    int tmp = ss->heap[a];
+    ss->heap[a] = ss->heap[b];
+    ss->heap[b] = tmp;
+    ss->counters[ss->heap[a]].heap_pos = a;
+    ss->counters[ss->heap[b]].heap_pos = b;
+}
+
+static void heap_sift_down(SpaceSaving *ss, int pos) {
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= ss->size) break;
+        if (child + 1 < ss->size &&
+            ss->counters[ss->heap[child + 1]].count < ss->counters[ss->heap[child]].count) child++;
+        if (ss->counters[ss->heap[pos]].count <= ss->counters[ss->heap[child]].count) break;
+        heap_swap(ss, pos, child);
+        pos = child;
+    }
+}
+
+static int ss_find(const SpaceSaving *ss, const char *key, size_t len, uint32_t h, size_t *slot) {
+    size_t pos = h & ss->mask;
+    int idx;
+    while ((idx = ss->slots[pos]) >= 0) {
+        const SSCounter *c = &ss->counters[idx];
+        if (c->hash == h && c->len == (int)len && memcmp(c->key, key, len) == 0) {
+            *slot = pos;
+            return idx;
+        }
+        pos = (pos + 1) & ss->mask;
+    }
+    *slot = pos;
+    return -1;
+}
+
+// Remove o slot com deslocamento para trás (mantém a sondagem linear sem lápides)
+static void ss_remove_slot(SpaceSaving *ss, size_t hole) {
+    size_t next = hole;
+    ss->slots[hole] = -1;
+    for (;;) {
+        next = (next + 1) & ss->mask;
+        int idx = ss->slots[next];
+        if (idx < 0) break;
+        size_t home = ss->counters[idx].hash & ss->mask;
+        // O item em next pode ir para hole se hole estiver entre home e next (circularmente)
+        int movable = (hole <= next) ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable) {
+            ss->slots[hole] = idx;
+            ss->slots[next] = -1;
+            hole = next;
+        }
+    }
+}
+
+void ss_add(SpaceSaving *ss, const char *key, size_t len, uint64_t hash, long long count) {
+    uint32_t h = (uint32_t)hash;
+    size_t slot;
+    int idx = ss_find(ss, key, len, h, &slot);
+    if (idx >= 0) {
+        ss->counters[idx].count += count;
+        if (ss->size == ss->capacity) heap_sift_down(ss, ss->counters[idx].heap_pos);
+        return;
+    }
+
+    SSCounter *c;
+    int is_new = ss->size < ss->capacity;
+    if (is_new) {
+        idx = ss->size++;
+        c = &ss->counters[idx];
+        c->count = count;
+        c->error = 0;
+        c->heap_pos = idx;
+        ss->heap[idx] = idx;
+    } else {
+        // Substitui o item de menor contagem: o novo herda essa contagem como erro
+        idx = ss->heap[0];
+        c = &ss->counters[idx];
+        size_t old_slot;
+        ss_find(ss, c->key, c->len, c->hash, &old_slot);
+        ss_remove_slot(ss, old_slot);
+        ss_find(ss, key, len, h, &slot);
+        c->error = c->count;
+        c->count += count;
+    }
+    memcpy(c->key, key, len);
+    c->key[len] = '\0';
+    c->len = (int)len;
+    c->hash = h;
+    ss->slots[slot] = idx;
+    if (!is_new) {
+        heap_sift_down(ss, c->heap_pos);
+    } else if (ss->size == ss->capacity) {
+        // O heap só é necessário para as substituições: é montado quando enche
+        for (int i = ss->size / 2 - 1; i >= 0; i--) heap_sift_down(ss, i);
+    }
+}
+
+long long ss_min_count(const SpaceSaving *ss) {
+    return ss->size < ss->capacity ? 0 : ss->counters[ss->heap[0]].count;
+}
+
+static int compare_counters_desc(const void *a, const void *b) {
+    const SSCounter *x = a, *y = b;
+    if (x->count != y->count) return (y->count > x->count) - (y->count < x->count);
+    return strcmp(x->key, y->key);
+}
+
+// Reconstrói índice e heap a partir de n contadores candidatos, mantendo os
+// capacity de maior contagem
+static void ss_rebuild(SpaceSaving *ss, SSCounter *cands, int n) {
+    qsort(cands, n, sizeof(SSCounter), compare_counters_desc);
+    if (n > ss->capacity) n = ss->capacity;
+    for (size_t i = 0; i <= ss->mask; i++) ss->slots[i] = -1;
+    ss->size = 0;
+    for (int i = 0; i < n; i++) {
+        SSCounter *c = &ss->counters[i];
+        size_t slot;
+        *c = cands[i];
+        ss_find(ss, c->key, c->len, c->hash, &slot);
+        ss->slots[slot] = i;
+        ss->heap[i] = i;
+        c->heap_pos = i;
+        ss->size++;
+    }
+    for (int i = n / 2 - 1; i >= 0; i--) heap_sift_down(ss, i);
+}
+
+// Mescla de resumos Space-Saving (Agarwal et al., "Mergeable Summaries"):
+// um item ausente de um dos lados pode ter até ss_min_count daquele lado,
+// valor somado à contagem e ao erro; depois ficam os capacity maiores.
+void ss_merge(SpaceSaving *dst, const SpaceSaving *src) {
+    long long dst_min = ss_min_count(dst), src_min = ss_min_count(src);
+    SSCounter *cands = sketch_realloc(NULL, (dst->size + src->size + 1) * sizeof(SSCounter));
+    int n = 0;
+
+    for (int i = 0; i < dst->size; i++) {
+        SSCounter c = dst->counters[i];
+        size_t slot;
+        int j = ss_find(src, c.key, c.len, c.hash, &slot);
+        c.count += j >= 0 ? src->counters[j].count : src_min;
+        c.error += j >= 0 ? src->counters[j].error : src_min;
+        cands[n++] = c;
+    }
+    for (int i = 0; i < src->size; i++) {
+        SSCounter c = src->counters[i];
+        size_t slot;
+        if (ss_find(dst, c.key, c.len, c.hash, &slot) >= 0) continue;
+        c.count += dst_min;
+        c.error += dst_min;
+        cands[n++] = c;
+    }
+    ss_rebuild(dst, cands, n);
+    free(cands);
+}
+
+int ss_top(const SpaceSaving *ss, int k, int *out) {
+    int n = 0;
+    for (int i = 0; i < ss->size; i++) {
+        // Inserção ordenada: k é pequeno (TOP_N)
+        int pos = n < k ? n++ : k;
+        if (pos == k && compare_counters_desc(&ss->counters[i], &ss->counters[out[k - 1]]) >= 0) continue;
+        if (pos == k) pos = k - 1;
+        while (pos > 0 && compare_counters_desc(&ss->counters[i], &ss->counters[out[pos - 1]]) < 0) {
+            out[pos] = out[pos - 1];
+            pos--;
+        }
+        out[pos] = i;
+    }
+    return n;
+}
+
+// Formato: varint capacidade | varint n | n x (varint tam, chave, varint count, varint erro)
+void ss_serialize(const SpaceSaving *ss, ByteBuf *out) {
+    wire_put_varint(out, (uint64_t)ss->capacity);
+    wire_put_varint(out, (uint64_t)ss->size);
+    for (int i = 0; i < ss->size; i++) {
+        const SSCounter *c = &ss->counters[i];
+        wire_put_varint(out, (uint64_t)c->len);
+        bytebuf_append(out, c->key, c->len);
+        wire_put_varint(out, (uint64_t)c->count);
+        wire_put_varint(out, (uint64_t)c->error);
+    }
+}
+
+int ss_merge_serialized(SpaceSaving *dst, const unsigned char *data, size_t size, size_t *consumed) {
+    const unsigned char *p = data, *end = data + size;
+    uint64_t capacity, n;
+    if (wire_get_varint(&p, end, &capacity) < 0 || wire_get_varint(&p, end, &n) < 0) return -1;
+    if (capacity == 0 || capacity > (1u << 30) || n > capacity) return -1;
+
+    SpaceSaving src;
+    ss_init(&src, (int)capacity);
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t len, count, error;
+        if (wire_get_varint(&p, end, &len) < 0 || len >= SKETCH_MAX_KEY || len > (uint64_t)(end - p)) {
+            ss_free(&src);
+            return -1;
+        }
+        const char *key = (const char *)p;
+        uint64_t h = sketch_hash(key, len);
+        size_t slot;
+        p += len;
+        // Chave repetida também indica bloco corrompido
+        if (wire_get_varint(&p, end, &count) < 0 || wire_get_varint(&p, end, &error) < 0 ||
+            ss_find(&src, key, len, (uint32_t)h, &slot) >= 0) {
+            ss_free(&src);
+            return -1;
+        }
+        ss_add(&src, key, len, h, (long long)count);
+        src.counters[src.size - 1].error = (long long)error;
+    }
+    ss_merge(dst, &src);
+    ss_free(&src);
+    *consumed = (size_t)(p - data);
+    return 0;
+}
+
+// --- HyperLogLog ---
+
+void hll_init(HyperLogLog *hll) {
+    memset(hll->reg, 0, sizeof(hll->reg));
+}
+
+void hll_add(HyperLogLog *hll, uint64_t hash) {
+    uint32_t idx = (uint32_t)(hash >> (64 - HLL_PRECISION));
+    // Bit sentinela garante rho <= 64 - HLL_PRECISION + 1
+    uint64_t rest = (hash << HLL_PRECISION) | (1ull << (HLL_PRECISION - 1));
+    unsigned char rho = (unsigned char)(__builtin_clzll(rest) + 1);
+    if (rho > hll->reg[idx]) hll->reg[idx] = rho;
+}
+
+void hll_merge(HyperLogLog *dst, const HyperLogLog *src) {
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        if (src->reg[i] > dst->reg[i]) dst->reg[i] = src->reg[i];
+    }
+}
+
+double hll_estimate(const HyperLogLog *hll) {
+    const double m = HLL_REGISTERS;
+    double sum = 0.0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -hll->reg[i]);
+        if (hll->reg[i] == 0) zeros++;
+    }
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    // Correção para cardinalidades pequenas (contagem linear)
+    if (estimate <= 2.5 * m && zeros > 0) estimate = m * log(m / zeros);
+    return estimate;
+}
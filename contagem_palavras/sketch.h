@@ -0,0 +1,66 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wire.h"
+
+// Resumos de memória fixa para o modo aproximado (--approx), todos mescláveis
+// entre threads e ranks:
+//  - SpaceSaving: os itens mais frequentes (heavy hitters) com no máximo
+//    `capacity` contadores. A contagem de cada item monitorado é um limite
+//    superior da real, que é no mínimo count - error.
+//  - HyperLogLog: estimativa do número de chaves distintas (erro ~0,8%).
+
+#define SKETCH_MAX_KEY 256
+#define HLL_PRECISION 14
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+
+typedef struct {
+    char key[SKETCH_MAX_KEY];
+    int len;
+    uint32_t hash;
+    int heap_pos;
+    long long count;   // limite superior da contagem real
+    long long error;   // superestimação máxima
+} SSCounter;
+
+typedef struct {
+    SSCounter *counters;
+    int *heap;         // min-heap (por count) de índices em counters, válido quando cheio
+    int *slots;        // índice hash por sondagem linear, -1 = vazio
+    size_t mask;
+    int capacity;
+    int size;
+} SpaceSaving;
+
+typedef struct {
+    unsigned char reg[HLL_REGISTERS];
+} HyperLogLog;
+
+// Hash de 64 bits das chaves, compartilhado pelos dois resumos
+uint64_t sketch_hash(const char *key, size_t len);
+
+void ss_init(SpaceSaving *ss, int capacity);
+void ss_free(SpaceSaving *ss);
+// Soma count ao item (hash = sketch_hash(key, len)); len < SKETCH_MAX_KEY
+void ss_add(SpaceSaving *ss, const char *key, size_t len, uint64_t hash, long long count);
+// Mescla src em dst (os dois com a mesma capacidade)
+void ss_merge(SpaceSaving *dst, const SpaceSaving *src);
+// Maior contagem que um item não monitorado pode ter
+long long ss_min_count(const SpaceSaving *ss);
+// Índices dos k itens de maior contagem, do maior para o menor; retorna quantos
+int ss_top(const SpaceSaving *ss, int k, int *out);
+
+void ss_serialize(const SpaceSaving *ss, ByteBuf *out);
+// Desserializa o resumo que começa em data e mescla em dst; *consumed recebe
+// o tamanho ocupado por ele. Retorna 0 ou -1 se estiver corrompido.
+int ss_merge_serialized(SpaceSaving *dst, const unsigned char *data, size_t size, size_t *consumed);
+
+void hll_init(HyperLogLog *hll);
+void hll_add(HyperLogLog *hll, uint64_t hash);
+void hll_merge(HyperLogLog *dst, const HyperLogLog *src);
+double hll_estimate(const HyperLogLog *hll);
+
+#endif
@@ -0,0 +1,105 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t snapshot_fingerprint(MPI_File fh, MPI_Offset offset) {
+    char window[SNAPSHOT_FINGERPRINT_BYTES];
+    MPI_Offset start = offset > SNAPSHOT_FINGERPRINT_BYTES ? offset - SNAPSHOT_FINGERPRINT_BYTES : 0;
+    int n = (int)(offset - start), got = 0;
+    MPI_Status status;
+    if (n > 0 && MPI_File_read_at(fh, start, window, n, MPI_CHAR, &status) == MPI_SUCCESS) {
+        MPI_Get_count(&status, MPI_CHAR, &got);
+    }
+
+    // FNV-1a de 64 bits, incluindo a posição para distinguir prefixos vazios
+    uint64_t h = 14695981039346656037ULL ^ (uint64_t)offset;
+    for (int i = 0; i < got; i++) {
+        h ^= (unsigned char)window[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int snapshot_last_byte(MPI_File fh, MPI_Offset offset) {
+    unsigned char byte;
+    int got = 0;
+    MPI_Status status;
+    if (offset <= 0 || MPI_File_read_at(fh, offset - 1, &byte, 1, MPI_CHAR, &status) != MPI_SUCCESS) {
+        return SNAPSHOT_NO_BYTE;
+    }
+    MPI_Get_count(&status, MPI_CHAR, &got);
+    return got == 1 ? byte : SNAPSHOT_NO_BYTE;
+}
+
+unsigned char *snapshot_read(const char *path, SnapshotHeader *header) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    unsigned char *data = NULL;
+    if (fread(header, sizeof(*header), 1, f) == 1 &&
+        memcmp(header->magic, SNAPSHOT_MAGIC, 8) == 0 &&
+        header->version == SNAPSHOT_VERSION &&
+        header->header_size == sizeof(SnapshotHeader)) {
+        data = malloc(header->data_size > 0 ? header->data_size : 1);
+        if (data != NULL && fread(data, 1, header->data_size, f) != header->data_size) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(f);
+    return data;
+}
+
+// Escreve len bytes em offset (em blocos, pois a contagem do MPI é int)
+static int write_at(MPI_File fh, MPI_Offset offset, const char *buf, size_t len) {
+    const size_t max_block = 1 << 30;
+    while (len > 0) {
+        int n = (int)(len < max_block ? len : max_block);
+        MPI_Status status;
+        if (MPI_File_write_at(fh, offset, buf, n, MPI_BYTE, &status) != MPI_SUCCESS) return -1;
+        offset += n;
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int snapshot_write(const char *path, const SnapshotHeader *header, const void *data, size_t size) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Posição do trecho de cada rank: soma prefixada dos tamanhos
+    unsigned long long mine = size, before = 0, total = 0;
+    MPI_Exscan(&mine, &before, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) before = 0;
+    MPI_Allreduce(&mine, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, tmp_path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) return -1;
+    MPI_File_set_size(fh, 0);
+
+    int ok = 1;
+    if (rank == 0) {
+        SnapshotHeader h = *header;
+        memcpy(h.magic, SNAPSHOT_MAGIC, 8);
+        h.version = SNAPSHOT_VERSION;
+        h.header_size = sizeof(SnapshotHeader);
+        h.data_size = total;
+        ok = write_at(fh, 0, (const char *)&h, sizeof(h)) == 0;
+    }
+    if (ok) ok = write_at(fh, (MPI_Offset)(sizeof(SnapshotHeader) + before), data, size) == 0;
+    MPI_File_close(&fh);
+
+    int all_ok;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    if (rank == 0) {
+        if (all_ok) all_ok = rename(tmp_path, path) == 0;
+        else remove(tmp_path);
+    }
+    MPI_Bcast(&all_ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return all_ok ? 0 : -1;
+}
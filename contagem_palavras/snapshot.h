@@ -0,0 +1,54 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <mpi.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Snapshot das contagens para reanálise incremental (--snapshot / --incremental).
+//
+// Layout: SnapshotHeader seguido de data_size bytes com pares de blocos
+// (palavras, artistas) no formato de wire.h, um par por rank que gravou. Os
+// pares têm chaves disjuntas, então a soma de todos é a tabela completa.
+//
+// processed é até onde o CSV já foi contabilizado; fingerprint é o hash dos
+// últimos SNAPSHOT_FINGERPRINT_BYTES bytes antes dessa posição, para detectar
+// um arquivo que foi reescrito em vez de apenas crescer. last_byte é o byte em
+// processed - 1: a reanálise só continua de processed se ele for '\n' (se o
+// arquivo não terminava em '\n', o que foi acrescentado continua a última
+// música, já contada pela metade).
+
+#define SNAPSHOT_MAGIC "SPSNAP01"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_FINGERPRINT_BYTES 4096
+#define SNAPSHOT_NO_BYTE 256
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t processed;     // bytes do CSV já contabilizados
+    uint64_t fingerprint;
+    uint64_t last_byte;     // byte em processed - 1 (SNAPSHOT_NO_BYTE se processed == 0)
+    uint64_t tokens;        // palavras contadas até processed
+    uint64_t lines;         // linhas (músicas) até processed
+    uint64_t data_size;     // bytes das tabelas codificadas após o cabeçalho
+} SnapshotHeader;
+
+// Hash dos SNAPSHOT_FINGERPRINT_BYTES bytes anteriores a offset (chamada independente)
+uint64_t snapshot_fingerprint(MPI_File fh, MPI_Offset offset);
+
+// Byte em offset - 1, ou SNAPSHOT_NO_BYTE se offset == 0 ou a leitura falhar (chamada independente)
+int snapshot_last_byte(MPI_File fh, MPI_Offset offset);
+
+// Lê e valida o snapshot (sem MPI; chamado só pelo rank 0). Retorna as tabelas
+// codificadas (a liberar com free) ou NULL se o arquivo não existe ou é inválido.
+unsigned char *snapshot_read(const char *path, SnapshotHeader *header);
+
+// Operação coletiva: cada rank contribui com data[0..size) e os trechos são
+// gravados em ordem de rank após o cabeçalho do rank 0 (data_size é
+// preenchido aqui). O arquivo é escrito em path.tmp e renomeado ao final,
+// então um snapshot antigo nunca fica pela metade. Retorna 0 ou -1 em todos os ranks.
+int snapshot_write(const char *path, const SnapshotHeader *header, const void *data, size_t size);
+
+#endif
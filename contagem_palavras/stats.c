@@ -0,0 +1,121 @@
+#include "stats.h"
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+RankStats rank_stats;
+
+static const char *phase_names[PHASE_COUNT] = {
+    "leitura", "processamento", "mescla threads", "redução", "saída"
+};
+
+// Métricas na ordem em que são enviadas ao rank 0 (todas como double)
+#define N_METRICS (PHASE_COUNT + 6)
+
+static const char *metric_names[N_METRICS] = {
+    "leitura", "processamento", "mescla_threads", "reducao", "saida",
+    "total", "bytes", "linhas", "palavras", "palavras_unicas", "pico_rss_kb"
+};
+
+static void pack_metrics(const RankStats *s, double *out) {
+    for (int p = 0; p < PHASE_COUNT; p++) out[p] = s->time[p];
+    out[PHASE_COUNT] = s->total;
+    out[PHASE_COUNT + 1] = (double)s->bytes;
+    out[PHASE_COUNT + 2] = (double)s->lines;
+    out[PHASE_COUNT + 3] = (double)s->tokens;
+    out[PHASE_COUNT + 4] = (double)s->unique_words;
+    out[PHASE_COUNT + 5] = (double)s->peak_rss_kb;
+}
+
+// Imprime s alinhado à esquerda em width colunas (conta caracteres UTF-8, não bytes)
+static void print_padded(const char *s, int width) {
+    int chars = 0;
+    for (const char *p = s; *p; p++) {
+        if (((unsigned char)*p & 0xC0) != 0x80) chars++;
+    }
+    printf("%s%*s", s, width > chars ? width - chars : 0, "");
+}
+
+static void print_row(const char *name, const double *all, int metric, int nprocs, double scale, const char *fmt) {
+    double min = all[metric], max = all[metric], sum = 0.0;
+    int slowest = 0;
+    for (int r = 0; r < nprocs; r++) {
+        double v = all[r * N_METRICS + metric];
+        sum += v;
+        if (v < min) min = v;
+        if (v > max) {
+            max = v;
+            slowest = r;
+        }
+    }
+    double avg = sum / nprocs;
+    printf("  ");
+    print_padded(name, 17);
+    printf(fmt, min * scale);
+    printf(fmt, avg * scale);
+    printf(fmt, max * scale);
+    if (avg > 0) printf("  %6.2f  %5d\n", max / avg, slowest);
+    else printf("  %6s  %5s\n", "-", "-");
+}
+
+static void write_json(const char *path, const double *all, int nprocs) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Erro ao criar o arquivo de estatísticas %s\n", path);
+        return;
+    }
+    fprintf(f, "{\n  \"processos\": %d,\n  \"ranks\": [\n", nprocs);
+    for (int r = 0; r < nprocs; r++) {
+        fprintf(f, "    {\"rank\": %d", r);
+        for (int m = 0; m < N_METRICS; m++) {
+            // Tempos em segundos; as demais métricas são contagens inteiras
+            if (m <= PHASE_COUNT) fprintf(f, ", \"%s\": %.6f", metric_names[m], all[r * N_METRICS + m]);
+            else fprintf(f, ", \"%s\": %.0f", metric_names[m], all[r * N_METRICS + m]);
+        }
+        fprintf(f, "}%s\n", r + 1 < nprocs ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+void stats_report(int rank, int nprocs, const char *json_path) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        rank_stats.peak_rss_kb = (unsigned long long)usage.ru_maxrss;  // em KB no Linux
+    }
+
+    double local[N_METRICS];
+    double *all = NULL;
+    pack_metrics(&rank_stats, local);
+    if (rank == 0) {
+        all = malloc((size_t)nprocs * N_METRICS * sizeof(double));
+        if (all == NULL) {
+            fprintf(stderr, "Erro: memória insuficiente para as estatísticas\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(local, N_METRICS, MPI_DOUBLE, all, N_METRICS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (rank != 0) return;
+
+    printf("\n--- Desempenho por rank (mín / média / máx) ---\n");
+    printf("  ");
+    print_padded("métrica", 17);
+    printf("          mín        média          máx máx/méd   rank\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        print_row(phase_names[p], all, p, nprocs, 1.0, " %11.3fs");
+    }
+    print_row("total", all, PHASE_COUNT, nprocs, 1.0, " %11.3fs");
+    print_row("MB lidos", all, PHASE_COUNT + 1, nprocs, 1.0 / (1024 * 1024), " %12.2f");
+    print_row("linhas", all, PHASE_COUNT + 2, nprocs, 1.0, " %12.0f");
+    print_row("palavras", all, PHASE_COUNT + 3, nprocs, 1.0, " %12.0f");
+    print_row("palavras únicas", all, PHASE_COUNT + 4, nprocs, 1.0, " %12.0f");
+    print_row("pico RSS (MB)", all, PHASE_COUNT + 5, nprocs, 1.0 / 1024, " %12.1f");
+
+    if (json_path != NULL) {
+        write_json(json_path, all, nprocs);
+        printf("Estatísticas por rank salvas em: %s\n", json_path);
+    }
+    free(all);
+}
@@ -0,0 +1,34 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Instrumentação por rank: tempo de cada fase do processamento e volume de
+// dados tratado. Ao final, stats_report reúne os valores de todos os ranks no
+// rank 0 e mostra mínimo, média e máximo de cada métrica, com o desequilíbrio
+// (máx / média) e o rank mais lento.
+
+typedef enum {
+    PHASE_READ,      // leitura do arquivo (no streaming, só a espera pelo I/O)
+    PHASE_PROCESS,   // extração dos campos do CSV e tokenização/contagem
+    PHASE_MERGE,     // mescla das tabelas das threads
+    PHASE_REDUCE,    // redução entre ranks
+    PHASE_OUTPUT,    // seleção do top-N e impressão (rank 0)
+    PHASE_COUNT
+} Phase;
+
+typedef struct {
+    double time[PHASE_COUNT];
+    double total;
+    unsigned long long bytes;         // bytes do arquivo lidos pelo rank
+    unsigned long long lines;         // linhas (músicas) processadas
+    unsigned long long tokens;        // palavras contadas
+    unsigned long long unique_words;  // palavras distintas antes da redução
+    unsigned long long peak_rss_kb;   // pico de memória residente do processo
+} RankStats;
+
+extern RankStats rank_stats;
+
+// Operação coletiva: todos os ranks devem chamar. O rank 0 imprime a tabela e,
+// se json_path != NULL, grava os valores por rank em JSON.
+void stats_report(int rank, int nprocs, const char *json_path);
+
+#endif
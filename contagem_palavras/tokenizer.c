@@ -0,0 +1,305 @@
+#include "tokenizer.h"
+#include "unicode_tables.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOKENIZER_X86 1
+#endif
+
+#define CLASS_DELIM 0x01
+#define CLASS_ALPHA 0x02
+
+_Static_assert(CLASS_DELIM == UNICODE_CLASS_DELIM && CLASS_ALPHA == UNICODE_CLASS_ALPHA,
+               "classes de unicode_tables.h diferentes das do tokenizador");
+
+static const char DELIMITERS[] = " \t\n\r,.-?!\"()[]{}:;/\\";
+
+// Classe de cada byte ASCII (delimitador / letra) e sua versão minúscula
+static unsigned char byte_class[256];
+static unsigned char byte_lower[256];
+// Tamanho da sequência UTF-8 pelo byte inicial (0 = byte inválido como início)
+static unsigned char utf8_length[256];
+
+// Estado de uma palavra que pode atravessar blocos
+typedef struct {
+    char *start;    // início da palavra atual, NULL fora de palavra
+    int has_alpha;
+} ScanState;
+
+static void init_tables(void) {
+    for (int c = 0; c < 256; c++) {
+        byte_class[c] = 0;
+        byte_lower[c] = (unsigned char)c;
+        if (c >= 'A' && c <= 'Z') byte_lower[c] = (unsigned char)(c + ('a' - 'A'));
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) byte_class[c] |= CLASS_ALPHA;
+    }
+    for (const char *d = DELIMITERS; *d; d++) byte_class[(unsigned char)*d] |= CLASS_DELIM;
+    for (int c = 0; c < 256; c++) {
+        // C0/C1 só formariam sequências longas demais; F5-FF passariam de U+10FFFF
+        utf8_length[c] = c < 0x80 ? 1 : c < 0xC2 ? 0 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : c < 0xF5 ? 4 : 0;
+    }
+}
+
+// Decodifica o caractere UTF-8 em p (que começa com um byte >= 0x80), troca-o
+// pela sua minúscula no próprio buffer e devolve o tamanho em bytes e a classe.
+// Uma sequência inválida conta como um byte de palavra comum, sem conversão.
+static inline int fold_utf8(char *p, const char *end, unsigned char *cls) {
+    unsigned char *s = (unsigned char *)p;
+    int n = utf8_length[s[0]];
+    uint32_t cp;
+    *cls = 0;
+    if (n == 0 || n > end - p) return 1;
+    switch (n) {
+        case 2:
+            if ((s[1] & 0xC0) != 0x80) return 1;
+            cp = ((uint32_t)(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+            break;
+        case 3:
+            if ((s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80) return 1;
+            cp = ((uint32_t)(s[0] & 0x0F) << 12) | ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+            if (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF)) return 1;
+            break;
+        default:
+            if ((s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 || (s[3] & 0xC0) != 0x80) return 1;
+            cp = ((uint32_t)(s[0] & 0x07) << 18) | ((uint32_t)(s[1] & 0x3F) << 12) |
+                 ((uint32_t)(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+            if (cp < 0x10000 || cp > 0x10FFFF) return 1;
+            break;
+    }
+
+    uint16_t entry = unicode_stage2[((uint32_t)unicode_stage1[cp >> UNICODE_BLOCK_BITS] << UNICODE_BLOCK_BITS) |
+                                    (cp & ((1u << UNICODE_BLOCK_BITS) - 1))];
+    *cls = (unsigned char)(entry & 3);
+    int32_t delta = unicode_deltas[entry >> 2];
+    if (delta != 0 && !(*cls & CLASS_DELIM)) {
+        // A tabela só tem minúsculas com o mesmo tamanho em UTF-8
+        uint32_t lower = (uint32_t)((int32_t)cp + delta);
+        switch (n) {
+            case 2:
+                s[0] = (unsigned char)(0xC0 | (lower >> 6));
+                s[1] = (unsigned char)(0x80 | (lower & 0x3F));
+                break;
+            case 3:
+                s[0] = (unsigned char)(0xE0 | (lower >> 12));
+                s[1] = (unsigned char)(0x80 | ((lower >> 6) & 0x3F));
+                s[2] = (unsigned char)(0x80 | (lower & 0x3F));
+                break;
+            default:
+                s[0] = (unsigned char)(0xF0 | (lower >> 18));
+                s[1] = (unsigned char)(0x80 | ((lower >> 12) & 0x3F));
+                s[2] = (unsigned char)(0x80 | ((lower >> 6) & 0x3F));
+                s[3] = (unsigned char)(0x80 | (lower & 0x3F));
+                break;
+        }
+    }
+    return n;
+}
+
+// Passada escalar sobre os caracteres que começam em [p, stop), continuando o
+// estado st. Um caractere UTF-8 pode terminar depois de stop (até end); retorna
+// a posição logo após o último caractere processado.
+static inline char *scan_scalar(char *p, char *stop, char *end, ScanState *st, TokenSink sink, void *ctx) {
+    while (p < stop) {
+        unsigned char c = (unsigned char)*p;
+        unsigned char cls;
+        int n = 1;
+        if (c < 0x80) {
+            cls = byte_class[c];
+            if (!(cls & CLASS_DELIM)) *p = (char)byte_lower[c];
+        } else {
+            n = fold_utf8(p, end, &cls);
+        }
+        if (cls & CLASS_DELIM) {
+            if (st->start) {
+                if (st->has_alpha) sink(ctx, st->start, (size_t)(p - st->start));
+                st->start = NULL;
+            }
+        } else {
+            if (!st->start) {
+                st->start = p;
+                st->has_alpha = 0;
+            }
+            st->has_alpha |= cls & CLASS_ALPHA;
+        }
+        p += n;
+    }
+    return p;
+}
+
+static inline void scan_finish(char *end, ScanState *st, TokenSink sink, void *ctx) {
+    if (st->start && st->has_alpha) sink(ctx, st->start, (size_t)(end - st->start));
+    st->start = NULL;
+}
+
+static void tokenize_scalar(char *text, size_t len, TokenSink sink, void *ctx) {
+    ScanState st = { NULL, 0 };
+    scan_scalar(text, text + len, text + len, &st, sink, ctx);
+    scan_finish(text + len, &st, sink, ctx);
+}
+
+#ifdef TOKENIZER_X86
+
+// Percorre as máscaras de um bloco de width bytes (bit i = byte i):
+// delim marca delimitadores e alpha marca letras
+static inline void scan_masks(char *base, uint64_t delim, uint64_t alpha, int width,
+                              ScanState *st, TokenSink sink, void *ctx) {
+    uint64_t word = ~delim & (width == 64 ? ~0ULL : ((1ULL << width) - 1));
+    int pos = 0;
+    while (pos < width) {
+        if (st->start) {
+            uint64_t rest = delim >> pos;
+            if (rest == 0) {
+                st->has_alpha |= (alpha >> pos) != 0;
+                return;
+            }
+            int k = __builtin_ctzll(rest);
+            st->has_alpha |= ((alpha >> pos) & ((1ULL << k) - 1)) != 0;
+            if (st->has_alpha) sink(ctx, st->start, (size_t)(base + pos + k - st->start));
+            st->start = NULL;
+            pos += k + 1;
+        } else {
+            uint64_t rest = word >> pos;
+            if (rest == 0) return;
+            pos += __builtin_ctzll(rest);
+            st->start = base + pos;
+            st->has_alpha = 0;
+        }
+    }
+}
+
+// Bloco com algum byte não ASCII (bit i de high = byte i >= 0x80): as máscaras
+// valem até o primeiro deles, e o trecho do primeiro ao último segue pelo
+// caminho escalar. Retorna a posição de onde a passada vetorial recomeça.
+static inline size_t scan_mixed_block(char *text, size_t i, size_t len, uint32_t high,
+                                      uint64_t delim, uint64_t alpha, ScanState *st, TokenSink sink, void *ctx) {
+    int first = __builtin_ctz(high);
+    int last = 31 - __builtin_clz(high);
+    uint64_t prefix = (1ULL << first) - 1;
+    scan_masks(text + i, delim & prefix, alpha & prefix, first, st, sink, ctx);
+    return (size_t)(scan_scalar(text + i + first, text + i + last + 1, text + len, st, sink, ctx) - text);
+}
+
+// Classificação por nibbles (pshufb): cada nibble alto usado pelos
+// delimitadores (0, 2, 3, 5, 7) ganha um bit; o byte é delimitador se a
+// tabela do nibble baixo tiver o bit do seu nibble alto.
+#define NIBBLE_HI_TABLE 1, 0, 2, 4, 0, 8, 0, 16, 0, 0, 0, 0, 0, 0, 0, 0
+#define NIBBLE_LO_TABLE 2, 2, 2, 0, 0, 0, 0, 0, 2, 3, 5, 28, 10, 27, 2, 6
+
+// Letras e maiúsculas usam comparação com sinal: x + (0x80 - base) fica em
+// [-128, -128 + 26) exatamente quando x está em [base, base + 26)
+#define RANGE_LIMIT (-128 + 26)
+
+__attribute__((target("avx2")))
+static void tokenize_avx2(char *text, size_t len, TokenSink sink, void *ctx) {
+    const __m256i hi_table = _mm256_setr_epi8(NIBBLE_HI_TABLE, NIBBLE_HI_TABLE);
+    const __m256i lo_table = _mm256_setr_epi8(NIBBLE_LO_TABLE, NIBBLE_LO_TABLE);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i limit = _mm256_set1_epi8(RANGE_LIMIT);
+    const __m256i upper_bias = _mm256_set1_epi8(0x80 - 'A');
+    const __m256i lower_bias = _mm256_set1_epi8(0x80 - 'a');
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+
+    ScanState st = { NULL, 0 };
+    size_t i = 0;
+    while (i + 32 <= len) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i lo = _mm256_and_si256(v, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i cls = _mm256_and_si256(_mm256_shuffle_epi8(lo_table, lo), _mm256_shuffle_epi8(hi_table, hi));
+        __m256i upper = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, upper_bias));
+        __m256i alpha = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(_mm256_or_si256(v, case_bit), lower_bias));
+        _mm256_storeu_si256((__m256i *)(text + i), _mm256_add_epi8(v, _mm256_and_si256(upper, case_bit)));
+
+        uint32_t delim = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cls, zero));
+        uint32_t alpha_mask = (uint32_t)_mm256_movemask_epi8(alpha);
+        uint32_t high = (uint32_t)_mm256_movemask_epi8(v);
+        if (high != 0) {
+            i = scan_mixed_block(text, i, len, high, delim, alpha_mask, &st, sink, ctx);
+            continue;
+        }
+        scan_masks(text + i, delim, alpha_mask, 32, &st, sink, ctx);
+        i += 32;
+    }
+    scan_scalar(text + i, text + len, text + len, &st, sink, ctx);
+    scan_finish(text + len, &st, sink, ctx);
+}
+
+__attribute__((target("sse4.2")))
+static void tokenize_sse42(char *text, size_t len, TokenSink sink, void *ctx) {
+    const __m128i hi_table = _mm_setr_epi8(NIBBLE_HI_TABLE);
+    const __m128i lo_table = _mm_setr_epi8(NIBBLE_LO_TABLE);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi8(RANGE_LIMIT);
+    const __m128i upper_bias = _mm_set1_epi8(0x80 - 'A');
+    const __m128i lower_bias = _mm_set1_epi8(0x80 - 'a');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+
+    ScanState st = { NULL, 0 };
+    size_t i = 0;
+    while (i + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i lo = _mm_and_si128(v, nibble);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+        __m128i cls = _mm_and_si128(_mm_shuffle_epi8(lo_table, lo), _mm_shuffle_epi8(hi_table, hi));
+        __m128i upper = _mm_cmpgt_epi8(limit, _mm_add_epi8(v, upper_bias));
+        __m128i alpha = _mm_cmpgt_epi8(limit, _mm_add_epi8(_mm_or_si128(v, case_bit), lower_bias));
+        _mm_storeu_si128((__m128i *)(text + i), _mm_add_epi8(v, _mm_and_si128(upper, case_bit)));
+
+        uint32_t delim = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(cls, zero)) & 0xFFFF;
+        uint32_t alpha_mask = (uint32_t)_mm_movemask_epi8(alpha);
+        uint32_t high = (uint32_t)_mm_movemask_epi8(v);
+        if (high != 0) {
+            i = scan_mixed_block(text, i, len, high, delim, alpha_mask, &st, sink, ctx);
+            continue;
+        }
+        scan_masks(text + i, delim, alpha_mask, 16, &st, sink, ctx);
+        i += 16;
+    }
+    scan_scalar(text + i, text + len, text + len, &st, sink, ctx);
+    scan_finish(text + len, &st, sink, ctx);
+}
+
+#endif
+
+static void (*tokenize_impl)(char *, size_t, TokenSink, void *) = tokenize_scalar;
+
+TokenizerKind tokenizer_select(TokenizerKind kind) {
+    init_tables();
+#ifdef TOKENIZER_X86
+    __builtin_cpu_init();
+    int has_avx2 = __builtin_cpu_supports("avx2");
+    int has_sse42 = __builtin_cpu_supports("sse4.2");
+    if (kind == TOKENIZER_AUTO) {
+        kind = has_avx2 ? TOKENIZER_AVX2 : has_sse42 ? TOKENIZER_SSE42 : TOKENIZER_SCALAR;
+    }
+    if (kind == TOKENIZER_AVX2 && !has_avx2) kind = has_sse42 ? TOKENIZER_SSE42 : TOKENIZER_SCALAR;
+    if (kind == TOKENIZER_SSE42 && !has_sse42) kind = TOKENIZER_SCALAR;
+    switch (kind) {
+        case TOKENIZER_AVX2: tokenize_impl = tokenize_avx2; break;
+        case TOKENIZER_SSE42: tokenize_impl = tokenize_sse42; break;
+        default: tokenize_impl = tokenize_scalar; break;
+    }
+#else
+    kind = TOKENIZER_SCALAR;
+    tokenize_impl = tokenize_scalar;
+#endif
+    return kind;
+}
+
+const char *tokenizer_name(TokenizerKind kind) {
+    switch (kind) {
+        case TOKENIZER_AVX2: return "AVX2";
+        case TOKENIZER_SSE42: return "SSE4.2";
+        case TOKENIZER_SCALAR: return "escalar";
+        default: return "automático";
+    }
+}
+
+void tokenize_lower(char *text, size_t len, TokenSink sink, void *ctx) {
+    tokenize_impl(text, len, sink, ctx);
+}
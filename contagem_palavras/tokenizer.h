@@ -0,0 +1,38 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stddef.h>
+
+// Tokenizador das letras: em uma única passada classifica os delimitadores,
+// converte para minúsculas (no próprio buffer) e encontra os limites das
+// palavras. O texto é UTF-8:
+//  - no ASCII, os delimitadores são os mesmos do antigo strtok:
+//      espaço \t \n \r , . - ? ! " ( ) [ ] { } : ; / (barra invertida)
+//  - fora do ASCII, espaços, pontuação (exceto o apóstrofo ’) e símbolos
+//    Unicode são delimitadores, e as letras são convertidas para a minúscula
+//    simples ("CORAÇÃO" -> "coração"), conforme unicode_tables.h.
+// As versões vetoriais tratam blocos só ASCII com máscaras e passam os
+// caracteres UTF-8 para o caminho escalar (table-driven).
+// Só são entregues as palavras que contêm ao menos uma letra.
+
+typedef enum {
+    TOKENIZER_AUTO,
+    TOKENIZER_SCALAR,
+    TOKENIZER_SSE42,
+    TOKENIZER_AVX2
+} TokenizerKind;
+
+// Recebe cada palavra como ponteiro + tamanho (não terminada em '\0')
+typedef void (*TokenSink)(void *ctx, const char *word, size_t len);
+
+// Escolhe a implementação; TOKENIZER_AUTO usa a melhor suportada pela CPU.
+// Deve ser chamada uma vez, antes de qualquer tokenize_lower (e antes de
+// criar threads). Retorna a implementação efetivamente selecionada.
+TokenizerKind tokenizer_select(TokenizerKind kind);
+
+const char *tokenizer_name(TokenizerKind kind);
+
+// Tokeniza text[0..len), convertendo-o para minúsculas no lugar
+void tokenize_lower(char *text, size_t len, TokenSink sink, void *ctx);
+
+#endif
@@ -0,0 +1,231 @@
+#include "wire.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 14
+#define LZ_MAX_OFFSET 65535
+
+static void *wire_realloc(void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (p == NULL && size > 0) {
+        fprintf(stderr, "Erro: memória insuficiente no codificador (%zu bytes)\n", size);
+        abort();
+    }
+    return p;
+}
+
+void bytebuf_init(ByteBuf *buf) {
+    buf->data = NULL;
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
+void bytebuf_free(ByteBuf *buf) {
+    free(buf->data);
+    bytebuf_init(buf);
+}
+
+static void bytebuf_reserve(ByteBuf *buf, size_t extra) {
+    if (buf->size + extra <= buf->capacity) return;
+    size_t capacity = buf->capacity ? buf->capacity : 256;
+    while (capacity < buf->size + extra) capacity *= 2;
+    buf->data = wire_realloc(buf->data, capacity);
+    buf->capacity = capacity;
+}
+
+void bytebuf_append(ByteBuf *buf, const void *data, size_t len) {
+    bytebuf_reserve(buf, len);
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+}
+
+void wire_put_varint(ByteBuf *buf, uint64_t v) {
+    bytebuf_reserve(buf, 10);
+    while (v >= 0x80) {
+        buf->data[buf->size++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    buf->data[buf->size++] = (unsigned char)v;
+}
+
+int wire_get_varint(const unsigned char **p, const unsigned char *end, uint64_t *out) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        unsigned char b = *(*p)++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// --- Compressão LZ77 simples ---
+// Sequências: varint n_literais | literais | varint tam_match | [varint distância]
+// Um tam_match 0 encerra o fluxo. Matches têm no mínimo LZ_MIN_MATCH bytes.
+
+static inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void lz_compress(ByteBuf *out, const unsigned char *src, size_t n) {
+    int32_t *table = wire_realloc(NULL, sizeof(int32_t) << LZ_HASH_BITS);
+    for (size_t i = 0; i < ((size_t)1 << LZ_HASH_BITS); i++) table[i] = -1;
+
+    size_t anchor = 0, i = 0;
+    while (i + LZ_MIN_MATCH <= n) {
+        uint32_t h = lz_hash(read32(src + i));
+        int32_t cand = table[h];
+        table[h] = (int32_t)i;
+        if (cand >= 0 && i - (size_t)cand <= LZ_MAX_OFFSET && read32(src + cand) == read32(src + i)) {
+            size_t len = LZ_MIN_MATCH;
+            while (i + len < n && src[cand + len] == src[i + len]) len++;
+            wire_put_varint(out, i - anchor);
+            bytebuf_append(out, src + anchor, i - anchor);
+            wire_put_varint(out, len);
+            wire_put_varint(out, i - (size_t)cand);
+            i += len;
+            anchor = i;
+        } else {
+            i++;
+        }
+    }
+    wire_put_varint(out, n - anchor);
+    bytebuf_append(out, src + anchor, n - anchor);
+    wire_put_varint(out, 0);
+    free(table);
+}
+
+static int lz_decompress(const unsigned char *p, const unsigned char *end, unsigned char *dst, size_t n) {
+    size_t pos = 0;
+    for (;;) {
+        uint64_t lit, len, dist;
+        if (wire_get_varint(&p, end, &lit) < 0 || lit > (uint64_t)(end - p) || lit > n - pos) return -1;
+        memcpy(dst + pos, p, lit);
+        p += lit;
+        pos += lit;
+        if (wire_get_varint(&p, end, &len) < 0) return -1;
+        if (len == 0) break;
+        if (wire_get_varint(&p, end, &dist) < 0 || dist == 0 || dist > pos || len > n - pos) return -1;
+        // Cópia byte a byte: a origem pode sobrepor o destino
+        for (uint64_t k = 0; k < len; k++, pos++) dst[pos] = dst[pos - dist];
+    }
+    return (pos == n && p == end) ? 0 : -1;
+}
+
+// --- Codificação das tabelas ---
+
+static int compare_refs(const void *a, const void *b) {
+    const KeyCountRef *x = a, *y = b;
+    int n = x->len < y->len ? x->len : y->len;
+    int c = memcmp(x->key, y->key, n);
+    if (c != 0) return c;
+    return x->len - y->len;
+}
+
+void wire_encode(ByteBuf *out, KeyCountRef *refs, int n, int compress) {
+    qsort(refs, n, sizeof(KeyCountRef), compare_refs);
+
+    ByteBuf body;
+    bytebuf_init(&body);
+    wire_put_varint(&body, (uint64_t)n);
+    const char *prev = "";
+    int prev_len = 0;
+    for (int i = 0; i < n; i++) {
+        int shared = 0;
+        while (shared < prev_len && shared < refs[i].len && prev[shared] == refs[i].key[shared]) shared++;
+        wire_put_varint(&body, (uint64_t)shared);
+        wire_put_varint(&body, (uint64_t)(refs[i].len - shared));
+        bytebuf_append(&body, refs[i].key + shared, refs[i].len - shared);
+        wire_put_varint(&body, (uint64_t)(unsigned int)refs[i].count);
+        prev = refs[i].key;
+        prev_len = refs[i].len;
+    }
+
+    unsigned char flags = 0;
+    if (compress) {
+        ByteBuf packed;
+        bytebuf_init(&packed);
+        lz_compress(&packed, body.data, body.size);
+        // Só usa a versão comprimida se ela de fato for menor
+        if (packed.size < body.size) {
+            flags |= WIRE_FLAG_LZ;
+            bytebuf_append(out, &flags, 1);
+            wire_put_varint(out, packed.size);
+            wire_put_varint(out, body.size);
+            bytebuf_append(out, packed.data, packed.size);
+        }
+        bytebuf_free(&packed);
+    }
+    if (!(flags & WIRE_FLAG_LZ)) {
+        bytebuf_append(out, &flags, 1);
+        wire_put_varint(out, body.size);
+        bytebuf_append(out, body.data, body.size);
+    }
+    bytebuf_free(&body);
+}
+
+int wire_reader_init(WireReader *r, const unsigned char *data, size_t size, size_t *consumed) {
+    const unsigned char *p = data, *end = data + size;
+    uint64_t body_size, raw_size = 0, n;
+
+    memset(r, 0, sizeof(*r));
+    if (p >= end) return -1;
+    unsigned char flags = *p++;
+    if (wire_get_varint(&p, end, &body_size) < 0) return -1;
+    if ((flags & WIRE_FLAG_LZ) && wire_get_varint(&p, end, &raw_size) < 0) return -1;
+    if (body_size > (uint64_t)(end - p)) return -1;
+    *consumed = (size_t)(p - data) + body_size;
+
+    if (flags & WIRE_FLAG_LZ) {
+        r->plain = wire_realloc(NULL, raw_size > 0 ? raw_size : 1);
+        if (lz_decompress(p, p + body_size, r->plain, raw_size) < 0) {
+            wire_reader_free(r);
+            return -1;
+        }
+        r->p = r->plain;
+        r->end = r->plain + raw_size;
+    } else {
+        r->p = p;
+        r->end = p + body_size;
+    }
+
+    if (wire_get_varint(&r->p, r->end, &n) < 0 || n > UINT32_MAX) {
+        wire_reader_free(r);
+        return -1;
+    }
+    r->remaining = (unsigned int)n;
+    return 0;
+}
+
+int wire_next(WireReader *r, int *count) {
+    uint64_t shared, suffix, c;
+    if (r->remaining == 0) return 0;
+    if (wire_get_varint(&r->p, r->end, &shared) < 0 || shared > (uint64_t)r->key_len) return -1;
+    if (wire_get_varint(&r->p, r->end, &suffix) < 0 || shared + suffix >= WIRE_MAX_KEY ||
+        suffix > (uint64_t)(r->end - r->p)) return -1;
+    memcpy(r->key + shared, r->p, suffix);
+    r->p += suffix;
+    r->key_len = (int)(shared + suffix);
+    r->key[r->key_len] = '\0';
+    if (wire_get_varint(&r->p, r->end, &c) < 0) return -1;
+    *count = (int)c;
+    r->remaining--;
+    return 1;
+}
+
+void wire_reader_free(WireReader *r) {
+    free(r->plain);
+    r->plain = NULL;
+}
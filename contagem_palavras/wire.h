@@ -0,0 +1,64 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Formato compacto para trocar tabelas de contagem entre ranks.
+//
+// Um bloco é auto-delimitado:
+//   flags (1 byte) | varint tamanho_do_corpo | [varint tamanho_original] | corpo
+// O corpo (possivelmente comprimido com LZ, flag WIRE_FLAG_LZ) contém:
+//   varint n | n x (varint prefixo_comum, varint tam_sufixo, sufixo, varint contagem)
+// As chaves são ordenadas antes da codificação, então cada uma guarda apenas o
+// sufixo que difere da anterior (front coding).
+
+#define WIRE_MAX_KEY 256
+#define WIRE_FLAG_LZ 0x01
+
+// Referência para um par (chave, contagem) a ser codificado
+typedef struct {
+    const char *key;
+    int len;
+    int count;
+} KeyCountRef;
+
+// Buffer de bytes com crescimento automático
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuf;
+
+void bytebuf_init(ByteBuf *buf);
+void bytebuf_free(ByteBuf *buf);
+void bytebuf_append(ByteBuf *buf, const void *data, size_t len);
+
+// Inteiros sem sinal em 7 bits por byte (bit alto = continua)
+void wire_put_varint(ByteBuf *buf, uint64_t v);
+// Lê um varint de [*p, end) e avança *p; retorna 0 ou -1 se truncado
+int wire_get_varint(const unsigned char **p, const unsigned char *end, uint64_t *out);
+
+// Anexa a out um bloco com os n pares de refs (refs é reordenado por chave)
+void wire_encode(ByteBuf *out, KeyCountRef *refs, int n, int compress);
+
+// Leitor sequencial de um bloco
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    unsigned char *plain;      // corpo descomprimido (NULL se o bloco não usa LZ)
+    unsigned int remaining;
+    char key[WIRE_MAX_KEY];    // chave atual, terminada em '\0'
+    int key_len;
+} WireReader;
+
+// Abre o bloco que começa em data; *consumed recebe o tamanho total do bloco.
+// Retorna 0 em caso de sucesso, -1 se o bloco estiver corrompido.
+int wire_reader_init(WireReader *r, const unsigned char *data, size_t size, size_t *consumed);
+
+// Avança para o próximo par: 1 = r->key/r->key_len/*count válidos, 0 = fim, -1 = erro
+int wire_next(WireReader *r, int *count);
+
+void wire_reader_free(WireReader *r);
+
+#endif
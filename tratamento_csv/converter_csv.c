@@ -0,0 +1,317 @@
+// Converte o CSV original de letras (artist,song,link,text, com campos entre
+// aspas que podem conter quebras de linha) para o formato binário colunar de
+// comum/corpus.h. Substitui o pré-processamento com pandas (tratar_csv.py):
+// a normalização das letras é a mesma, e os programas MPI passam a abrir o
+// resultado com mmap, sem parsing de CSV.
+//
+// Uso: ./converter_csv entrada.csv saida.bin
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#include "corpus.h"
+
+#define INITIAL_ARTIST_SLOTS 4096
+
+// Buffer de bytes com crescimento automático
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static void *xrealloc(void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (p == NULL && size > 0) {
+        fprintf(stderr, "Erro: memória insuficiente (%zu bytes)\n", size);
+        exit(1);
+    }
+    return p;
+}
+
+static void buffer_reserve(Buffer *buf, size_t extra) {
+    if (buf->size + extra <= buf->capacity) return;
+    size_t capacity = buf->capacity ? buf->capacity : 4096;
+    while (capacity < buf->size + extra) capacity *= 2;
+    buf->data = xrealloc(buf->data, capacity);
+    buf->capacity = capacity;
+}
+
+static void buffer_append(Buffer *buf, const void *data, size_t len) {
+    buffer_reserve(buf, len);
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+}
+
+// Coluna de strings: blob com as strings terminadas em '\0' + offsets
+typedef struct {
+    Buffer blob;
+    Buffer offsets;   // uint64[n + 1]
+} StringColumn;
+
+static void column_init(StringColumn *col) {
+    memset(col, 0, sizeof(*col));
+    uint64_t zero = 0;
+    buffer_append(&col->offsets, &zero, sizeof(zero));
+}
+
+static void column_add(StringColumn *col, const char *s, size_t len) {
+    buffer_append(&col->blob, s, len);
+    buffer_append(&col->blob, "", 1);
+    uint64_t end = col->blob.size;
+    buffer_append(&col->offsets, &end, sizeof(end));
+}
+
+// Dicionário de artistas: hash FNV-1a com sondagem linear sobre a coluna
+typedef struct {
+    StringColumn names;
+    uint32_t *slots;   // id + 1 (0 = vazio)
+    size_t mask;
+    uint32_t count;
+} ArtistDict;
+
+static uint32_t hash_bytes(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static const char *dict_name(const ArtistDict *d, uint32_t id, size_t *len) {
+    const uint64_t *off = (const uint64_t *)d->names.offsets.data;
+    *len = (size_t)(off[id + 1] - off[id] - 1);
+    return d->names.blob.data + off[id];
+}
+
+static void dict_grow(ArtistDict *d) {
+    size_t nslots = d->slots ? (d->mask + 1) * 2 : INITIAL_ARTIST_SLOTS;
+    uint32_t *slots = calloc(nslots, sizeof(uint32_t));
+    if (slots == NULL) {
+        fprintf(stderr, "Erro: memória insuficiente no dicionário de artistas\n");
+        exit(1);
+    }
+    for (uint32_t id = 0; id < d->count; id++) {
+        size_t len;
+        const char *name = dict_name(d, id, &len);
+        size_t pos = hash_bytes(name, len) & (nslots - 1);
+        while (slots[pos]) pos = (pos + 1) & (nslots - 1);
+        slots[pos] = id + 1;
+    }
+    free(d->slots);
+    d->slots = slots;
+    d->mask = nslots - 1;
+}
+
+static uint32_t dict_intern(ArtistDict *d, const char *s, size_t len) {
+    if (d->slots == NULL || (size_t)d->count * 2 >= d->mask + 1) dict_grow(d);
+    size_t pos = hash_bytes(s, len) & d->mask;
+    while (d->slots[pos]) {
+        size_t n;
+        const char *name = dict_name(d, d->slots[pos] - 1, &n);
+        if (n == len && memcmp(name, s, len) == 0) return d->slots[pos] - 1;
+        pos = (pos + 1) & d->mask;
+    }
+    column_add(&d->names, s, len);
+    d->slots[pos] = ++d->count;
+    return d->count - 1;
+}
+
+// Lê um campo CSV (RFC 4180) a partir de *p, desfazendo as aspas em out.
+// Retorna 1 se o registro continua (vírgula), 0 se terminou (fim de linha/arquivo).
+static int read_field(const char **p, const char *end, Buffer *out) {
+    const char *s = *p;
+    out->size = 0;
+    if (s < end && *s == '"') {
+        s++;
+        for (;;) {
+            const char *q = memchr(s, '"', (size_t)(end - s));
+            if (q == NULL) {
+                buffer_append(out, s, (size_t)(end - s));
+                s = end;
+                break;
+            }
+            buffer_append(out, s, (size_t)(q - s));
+            if (q + 1 < end && q[1] == '"') {
+                buffer_append(out, "\"", 1);
+                s = q + 2;
+            } else {
+                s = q + 1;
+                break;
+            }
+        }
+        // Conteúdo após a aspa de fechamento (malformado) é mantido, como no pandas
+        while (s < end && *s != ',' && *s != '\n') {
+            if (*s != '\r') buffer_append(out, s, 1);
+            s++;
+        }
+    } else {
+        const char *q = s;
+        while (q < end && *q != ',' && *q != '\n') q++;
+        size_t len = (size_t)(q - s);
+        if (len > 0 && q[-1] == '\r' && (q == end || *q == '\n')) len--;
+        buffer_append(out, s, len);
+        s = q;
+    }
+    if (s < end && *s == ',') {
+        *p = s + 1;
+        return 1;
+    }
+    *p = s < end ? s + 1 : s;
+    return 0;
+}
+
+// Mesma normalização do tratar_csv.py: \n e \r viram espaço e sequências de
+// espaços em branco viram um único espaço
+static size_t normalize_text(char *s, size_t len) {
+    size_t out = 0;
+    int in_space = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+            if (!in_space) s[out++] = ' ';
+            in_space = 1;
+        } else {
+            s[out++] = c;
+            in_space = 0;
+        }
+    }
+    return out;
+}
+
+static char *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    Buffer buf = {0};
+    size_t n;
+    do {
+        buffer_reserve(&buf, 1 << 20);
+        n = fread(buf.data + buf.size, 1, buf.capacity - buf.size, f);
+        buf.size += n;
+    } while (n > 0);
+    fclose(f);
+    *size = buf.size;
+    return buf.data;
+}
+
+// Retorna 0 ou -1 se a gravação falhou (disco cheio, por exemplo)
+static int write_section(FILE *f, const void *data, size_t len, uint64_t *offset) {
+    static const char pad[8] = {0};
+    *offset = (uint64_t)ftell(f);
+    if (fwrite(data, 1, len, f) != len) return -1;
+    if (len % 8 && fwrite(pad, 1, 8 - len % 8, f) != 8 - len % 8) return -1;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Uso: %s entrada.csv saida.bin\n", argv[0]);
+        return 1;
+    }
+
+    size_t size;
+    char *data = read_file(argv[1], &size);
+    if (data == NULL) {
+        fprintf(stderr, "Erro ao ler %s\n", argv[1]);
+        return 1;
+    }
+    const char *p = data, *end = data + size;
+
+    // Cabeçalho: localiza as colunas pelo nome
+    int col_index[CORPUS_COLUMNS] = { -1, -1, -1, -1 };
+    const char *names[CORPUS_COLUMNS] = { "artist", "song", "link", "text" };
+    Buffer field = {0};
+    int nfields = 0, more = 1;
+    while (more && p < end) {
+        more = read_field(&p, end, &field);
+        buffer_append(&field, "", 1);
+        for (int c = 0; c < CORPUS_COLUMNS; c++) {
+            if (strcasecmp(field.data, names[c]) == 0) col_index[c] = nfields;
+        }
+        nfields++;
+    }
+    for (int c = 0; c < CORPUS_COLUMNS; c++) {
+        if (col_index[c] < 0) {
+            fprintf(stderr, "Coluna '%s' não encontrada no cabeçalho.\n", names[c]);
+            return 1;
+        }
+    }
+
+    ArtistDict artists;
+    memset(&artists, 0, sizeof(artists));
+    column_init(&artists.names);
+    StringColumn columns[CORPUS_COLUMNS];
+    for (int c = 0; c < CORPUS_COLUMNS; c++) column_init(&columns[c]);
+    Buffer artist_ids = {0};
+    // Só as quatro colunas do corpus são guardadas; os demais campos vão para
+    // field, qualquer que seja a posição deles no registro
+    Buffer values[CORPUS_COLUMNS];
+    memset(values, 0, sizeof(values));
+    uint64_t rows = 0;
+
+    while (p < end) {
+        int n = 0;
+        size_t first_size = 0;
+        for (int c = 0; c < CORPUS_COLUMNS; c++) values[c].size = 0;   // colunas ausentes
+        more = 1;
+        while (more) {
+            Buffer *dst = &field;
+            for (int c = 0; c < CORPUS_COLUMNS; c++) {
+                if (col_index[c] == n) dst = &values[c];
+            }
+            more = read_field(&p, end, dst);
+            if (n == 0) first_size = dst->size;
+            n++;
+        }
+        if (n == 1 && first_size == 0) continue;   // linha em branco
+        for (int c = 0; c < CORPUS_COLUMNS; c++) {
+            Buffer *v = &values[c];
+            if (c == CORPUS_TEXT) v->size = normalize_text(v->data, v->size);
+            if (c == CORPUS_ARTIST) {
+                uint32_t id = dict_intern(&artists, v->data ? v->data : "", v->size);
+                buffer_append(&artist_ids, &id, sizeof(id));
+            } else {
+                column_add(&columns[c], v->data ? v->data : "", v->size);
+            }
+        }
+        rows++;
+    }
+
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Erro ao criar %s\n", argv[2]);
+        return 1;
+    }
+    CorpusHeader header;
+    memset(&header, 0, sizeof(header));
+    int failed = fwrite(&header, 1, sizeof(header), out) != sizeof(header);   // reescrito no final
+
+    columns[CORPUS_ARTIST] = artists.names;
+    failed |= write_section(out, artist_ids.data, artist_ids.size, &header.artist_ids) != 0;
+    for (int c = 0; c < CORPUS_COLUMNS; c++) {
+        failed |= write_section(out, columns[c].offsets.data, columns[c].offsets.size, &header.offsets[c]) != 0;
+        failed |= write_section(out, columns[c].blob.data, columns[c].blob.size, &header.blobs[c]) != 0;
+        header.blob_sizes[c] = columns[c].blob.size;
+    }
+
+    memcpy(header.magic, CORPUS_MAGIC, 8);
+    header.version = CORPUS_VERSION;
+    header.header_size = sizeof(CorpusHeader);
+    header.num_rows = rows;
+    header.num_artists = artists.count;
+    header.file_size = (uint64_t)ftell(out);
+    fseek(out, 0, SEEK_SET);
+    failed |= fwrite(&header, 1, sizeof(header), out) != sizeof(header);
+    if (fclose(out) != 0 || failed) {
+        fprintf(stderr, "Erro ao gravar %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("Processo concluído! O arquivo '%s' foi criado com %llu músicas e %u artistas (%.2f MB).\n",
+           argv[2], (unsigned long long)rows, artists.count, header.file_size / (1024.0 * 1024.0));
+    return 0;
+}